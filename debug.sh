@@ -1,6 +1,7 @@
 #!/bin/bash
 
 # TP2 - Test cache configurations
+# Extra options go to every run, e.g. ./debug.sh --ram-frames 2
 
 echo "Testing cache configurations..."
 echo ""
@@ -8,48 +9,36 @@ echo ""
 RESULTS_FILE="results_tp2.txt"
 echo "" > $RESULTS_FILE
 
-# Compile with specific sizes
-compile_with_sizes() {
-  echo "  Cleaning..."
-  rm -rf build bin
-  
-  echo "  Compiling with L1=$1, L2=$2, L3=$3..."
-  make CFLAGS="-Wall -Wextra -std=c11 -g -Iinclude -I.  -DL1_SIZE=$1 -DL2_SIZE=$2 -DL3_SIZE=$3" > /dev/null 2>&1
-  
-  return $? 
+STATS_FILE=$(mktemp)
+trap 'rm -f "$STATS_FILE"' EXIT
+
+# Build once; every configuration is chosen at runtime
+build() {
+  echo "  Compiling..."
+  make > /dev/null 2>&1
+
+  return $?
 }
 
-# Extract statistics (FIXED TIME EXTRACTION!)
+# Extract statistics from the CSV report (--stats csv): a header line and
+# one row, read by column name so new columns do not break anything
 extract_stats() {
-  local output="$1"
-  
-  # Extract hit rates
-  local l1_rate=$(echo "$output" | grep -A3 "L1 Cache Statistics" | grep "Hit Rate:" | grep -oP '\d+\.\d+' | head -1)
-  local l2_rate=$(echo "$output" | grep -A3 "L2 Cache Statistics" | grep "Hit Rate:" | grep -oP '\d+\.\d+' | head -1)
-  local l3_rate=$(echo "$output" | grep -A3 "L3 Cache Statistics" | grep "Hit Rate:" | grep -oP '\d+\.\d+' | head -1)
-  
-  # Extract totals
-  local total_accesses=$(echo "$output" | grep "Total Memory Accesses:" | grep -oP '\d+' | head -1)
-  local total_misses=$(echo "$output" | grep "Total Cache Misses:" | grep -oP '\d+' | head -1)
-  
-  # FIX: Extract ONLY the number from time line
-  local total_time=$(echo "$output" | grep "Total Time" | grep -oP '\d+' | head -1)
-  
-  # Calculate RAM rate
-  local ram_rate="0.00"
-  if [ -n "$total_accesses" ] && [ -n "$total_misses" ] && [ "$total_accesses" -gt 0 ]; then
-    ram_rate=$(awk "BEGIN {printf \"%.2f\", ($total_misses * 100.0) / $total_accesses}")
-  fi
-  
-  local disk_rate="0.00"
-  
-  # Defaults
-  l1_rate=${l1_rate:-0.00}
-  l2_rate=${l2_rate:-0.00}
-  l3_rate=${l3_rate:-0.00}
-  total_time=${total_time:-0}
-  
-  echo "$l1_rate|$l2_rate|$l3_rate|$ram_rate|$disk_rate|$total_time"
+  local csv="$1"
+
+  awk -F, '
+    NR == 1 { for (i = 1; i <= NF; i++) col[$i] = i; next }
+    function value(name) { return (name in col) ? $col[name] : "" }
+    function rate(part, whole) {
+      return (whole != "" && whole > 0) ? sprintf("%.2f", part * 100.0 / whole) : "0.00"
+    }
+    function level_rate(l) {
+      return rate(value(l "_hits"), value(l "_hits") + value(l "_misses"))
+    }
+    {
+      printf "%s|%s|%s|%s|%s|%s\n", level_rate("l1"), level_rate("l2"),
+             level_rate("l3"), rate(value("misses"), value("accesses")),
+             rate(value("disk_accesses"), value("accesses")), value("time") + 0
+    }' "$csv"
 }
 
 configs=(
@@ -63,6 +52,12 @@ configs=(
 echo "Cache 1  | Cache 2  | Cache 3  | Taxa C1 % | Taxa C2 % | Taxa C3 % | Taxa de RAM % | Taxa de disco %  | Tempo de execução (unidade)" | tee -a $RESULTS_FILE
 echo "---------|----------|----------|-----------|-----------|-----------|---------------|------------------|-------------------------------" | tee -a $RESULTS_FILE
 
+build
+if [ $? -ne 0 ]; then
+  echo "  ❌ Compilation FAILED!"
+  exit 1
+fi
+
 for config in "${configs[@]}"; do
   L1=$(echo $config | awk '{print $1}')
   L2=$(echo $config | awk '{print $2}')
@@ -71,15 +66,8 @@ for config in "${configs[@]}"; do
   echo ""
   echo "Testing L1=$L1, L2=$L2, L3=$L3..."
   
-  compile_with_sizes $L1 $L2 $L3
-  
-  if [ $? -ne 0 ]; then
-    echo "  ❌ Compilation FAILED!"
-    continue
-  fi
-  
-  output=$(./bin/exe 2>&1)
-  stats=$(extract_stats "$output")
+  ./bin/exe --lines "$L1,$L2,$L3" "$@" --stats csv --stats-file "$STATS_FILE" > /dev/null
+  stats=$(extract_stats "$STATS_FILE")
   
   IFS='|' read -r l1_rate l2_rate l3_rate ram_rate disk_rate time <<< "$stats"
   
@@ -87,9 +75,6 @@ for config in "${configs[@]}"; do
     "$L1" "$L2" "$L3" "$l1_rate%" "$l2_rate%" "$l3_rate%" "$ram_rate%" "$disk_rate%" "$time" | tee -a $RESULTS_FILE
 done
 
-rm -rf build bin
-make > /dev/null 2>&1
-
 echo ""
 echo "✓ Done!  Results saved to results_tp2.txt"
 echo ""
@@ -0,0 +1,78 @@
+#ifndef ASSEMBLER_H
+#define ASSEMBLER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "instruction.h"
+#include "ram.h"
+
+#define PROGRAM_HEADER_SIZE 32
+
+// A program file mapped into memory, its instructions decoded
+typedef struct ProgramImage {
+  const unsigned char* map;   // Whole file (read-only)
+  size_t size;
+  Instruction* code;          // Decoded instructions
+  int length;
+  int64_t result_address;     // Word shown as the result, -1 if none
+  const unsigned char* data;  // .word runs, applied by program_image_load_data
+} ProgramImage;
+
+int assembler_build(const char* source_path, const char* output_path);
+
+ProgramImage* program_image_open(const char* path);
+void program_image_close(ProgramImage* image);
+void program_image_load_data(const ProgramImage* image, RAM* ram);
+int program_image_data_overlaps(const ProgramImage* image, uint64_t begin,
+                                uint64_t end);
+
+#endif  // ASSEMBLER_H
+
+/*
+Montador: traduz um programa em texto para o formato binário que o
+simulador carrega com --program-file, sem recompilar nem limite de
+MEMORY_SIZE instruções.
+
+Sintaxe (uma instrução por linha; '#' ou ';' começam comentário):
+
+  .result 3              # palavra mostrada como "Resultado" no fim
+  .word 100 1 2 3        # RAM[100..102] = 1, 2, 3 antes de rodar
+  start:
+    COPY_EXT_REG 1, 10   # operandos separados por espaço ou vírgula
+    COPY_REG_RAM 1, 0
+  loop:
+    SUB 0, 4, 0
+    JGT loop             # rótulos valem o índice da instrução
+    HALT
+
+  Mnemônicos: os nomes de opcodes.h (maiúsculas ou minúsculas), cada um
+  com o número de operandos que a CPU usa: HALT 0, ADD/SUB/MUL/DIV 3,
+  COPY_REG_RAM/COPY_RAM_REG/COPY_EXT_REG/OBTAIN_REG 2, saltos 1. Um
+  operando é um inteiro (decimal ou 0x...) ou um rótulo. Erros saem como
+  "arquivo:linha: mensagem".
+
+assembler_build: Monta source_path e grava output_path. Retorna 0 ou -1.
+
+program_image_open: Mapeia (mmap) o arquivo e decodifica as instruções
+                    uma vez; os dados (.word) são lidos direto do
+                    mapeamento quando o programa roda.
+
+program_image_load_data: Escreve as palavras de .word na RAM (direto, sem
+                         passar pela hierarquia, como os outros programas
+                         preparam suas entradas).
+
+program_image_data_overlaps: 1 se algum .word cai em [begin, end). Com
+                             --fetch on, main recusa o programa se os
+                             dados invadem a região do código (cpu.h).
+
+Formato do arquivo (inteiros little-endian, varints como no trace):
+  Cabeçalho (32 bytes):
+    "UCMPROG\0" | versão (u32) | reservado (u32) | instruções (u64) |
+    palavra do resultado + 1 (u64, 0 = nenhuma)
+  Instruções: varint(zigzag(opcode)) seguido de varint(zigzag(operando))
+              para cada operando que o opcode usa (em geral 1 byte cada,
+              contra 16 do Instruction)
+  Dados até o fim: varint(endereço) | varint(palavras) |
+                   varint(zigzag(valor)) por palavra
+*/
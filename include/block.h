@@ -1,21 +1,51 @@
 #ifndef BLOCK_H
 #define BLOCK_H
 
-#define WORDS_PER_BLOCK 4  
+#include <stdint.h>
 
-typedef struct Block {
-  int words[WORDS_PER_BLOCK];
-} Block;
+#define BLOCK_DEFAULT_WORDS 4
+#define BLOCK_MAX_WORDS 256
 
-void block_init(Block* block);
-int block_get_word(const Block* block, int word_offset);
-void block_set_word(Block* block, int word_offset, int value);
-void block_copy(Block* dest, const Block* src);
+// Block size of a hierarchy, chosen when it is created. Always a power of
+// two, so an address splits into block and offset with a shift and a mask.
+typedef struct BlockShape {
+  int words;        // Words per block
+  int shift;        // log2(words)
+  uint64_t mask;    // words - 1
+} BlockShape;
+
+int block_shape_init(BlockShape* shape, int words);
+
+static inline uint64_t word_to_block(const BlockShape* shape,
+                                     uint64_t word_address) {
+  return word_address >> shape->shift;
+}
+
+static inline int word_to_offset(const BlockShape* shape,
+                                 uint64_t word_address) {
+  return (int)(word_address & shape->mask);
+}
+
+static inline uint64_t block_to_word(const BlockShape* shape,
+                                     uint64_t block_address) {
+  return block_address << shape->shift;
+}
+
+void block_init(int* block, int words);
+void block_copy(int* dest, const int* src, int words);
 
 #endif // BLOCK_H
 
 /*
-  WORDS_PER_BLOCK: Define que cada bloco tem 4 palavras (4 inteiros)
-  struct Block: Contém apenas um array de 4 inteiros
-  Funções auxiliares: Para manipular os blocos de forma segura
-*/
\ No newline at end of file
+  Um bloco é uma sequência de `words` inteiros guardada em memória de quem
+  o possui (o slab de linhas de uma cache, as páginas da RAM), e não mais
+  um array fixo de 4 posições: o tamanho vem da configuração (block-words).
+
+  block_shape_init: Aceita potências de dois de 1 a BLOCK_MAX_WORDS e
+                    calcula o shift e a máscara; -1 para outros valores
+  word_to_block/word_to_offset: Endereço da palavra -> bloco e posição no
+                                bloco (shift e máscara, sem divisão)
+  block_to_word: Primeira palavra de um bloco
+  block_init: Zera as `words` palavras do bloco
+  block_copy: Copia um bloco inteiro (RAM <-> cache, entre níveis)
+*/
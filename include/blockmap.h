@@ -0,0 +1,56 @@
+#ifndef BLOCKMAP_H
+#define BLOCKMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Table keyed by block (or page) number, open addressing with linear
+// probing. Entries are the caller's structs, each starting with a
+// `uint64_t key + 1` (0 = empty slot).
+typedef struct BlockMap {
+  unsigned char* entries;
+  size_t entry_size;
+  size_t capacity;        // Power of two, at most half full
+  size_t count;           // Keys in the table
+} BlockMap;
+
+static inline size_t blockmap_hash(uint64_t key) {
+  uint64_t h = key * 0x9E3779B97F4A7C15ULL;
+  return (size_t)(h ^ (h >> 32));
+}
+
+// Slot holding `key`, or the empty slot where it would go
+static inline void* blockmap_slot(const BlockMap* map, uint64_t key) {
+  size_t mask = map->capacity - 1;
+  size_t i = blockmap_hash(key) & mask;
+  for (;;) {
+    unsigned char* entry = map->entries + i * map->entry_size;
+    uint64_t stored = *(const uint64_t*)entry;
+    if (stored == 0 || stored == key + 1) return entry;
+    i = (i + 1) & mask;
+  }
+}
+
+int blockmap_init(BlockMap* map, size_t entry_size, size_t capacity);
+void blockmap_free(BlockMap* map);
+void* blockmap_find(const BlockMap* map, uint64_t key);
+void* blockmap_insert(BlockMap* map, uint64_t key, int* added);
+
+#endif  // BLOCKMAP_H
+
+/*
+Tabela hash dos blocos (ou páginas) já vistos, usada pela RAM (tabela de
+páginas), pelo analisador de reuso, pelo classificador de faltas e pelo
+perfil de acessos. Cada um guarda sua própria struct por entrada; o
+primeiro campo dela é a chave + 1, então uma entrada zerada é vazia.
+
+blockmap_init: Tabela vazia com `capacity` entradas (potência de dois) de
+               entry_size bytes. Retorna 0 ou -1.
+blockmap_find: Entrada da chave, NULL se ela não está na tabela.
+blockmap_insert: Entrada da chave; se ela não estava, ocupa uma entrada
+                 zerada (só a chave preenchida), soma 1 em count e põe
+                 *added = 1 (added pode ser NULL). Dobra a tabela antes de
+                 passar da metade, e devolve NULL se não houver memória
+                 para isso: nada muda e quem chama decide o que fazer.
+                 Ponteiros para entradas valem até o próximo insert.
+*/
@@ -1,31 +1,72 @@
 #ifndef CACHE_H
 #define CACHE_H
 
+#include <stdint.h>
+
 #include "block.h"
+#include "miss.h"
+
+#define CACHE_NO_TAG UINT64_MAX   // Tag of an empty line
+#define CACHE_SIMD_MIN_WAYS 8     // Narrower sets are scanned one by one
 
+// MESI state of a line in a core's private cache (multi-core only, smp.h)
+typedef enum {
+  CACHE_INVALID,
+  CACHE_SHARED,
+  CACHE_EXCLUSIVE,
+  CACHE_MODIFIED
+} CacheState;
+
+// valid and tag mirror Cache.tags[], which lookups read and which is the
+// authoritative copy; only cache_load and cache_invalidate change them
 typedef struct CacheLine {
   int valid;              // Is this line valid?  (1 = yes, 0 = no)
-  int tag;                // Tag to identify which RAM block is here
-  Block data;             // The actual data (4 words)
-  int lru_counter;        // For LRU:  timestamp of last access
+  int dirty;              // Modified since loaded? (write-back only)
+  uint64_t tag;           // Tag to identify which RAM block is here
+  int* data;              // The block's words (in the cache's slab)
+  int prefetched;         // Brought in by the prefetcher, not used yet
+  CacheState state;       // Coherence state (set by smp.c, else unused)
+  uint64_t ready_time;    // When that prefetch arrives (UCM time)
 } CacheLine;
 
 typedef struct Cache {
-  CacheLine* lines;       // Array of cache lines
+  CacheLine* lines;       // Array of cache lines (grouped set by set)
+
+  // Lookup and recency metadata, one array per field (same order as lines)
+  uint64_t* tags;         // Tag, or CACHE_NO_TAG if the line is empty
+  int* recency_prev;      // More recently used line of the set (-1 = MRU)
+  int* recency_next;      // Less recently used line of the set (-1 = LRU)
+  int simd;               // Tags are compared with AVX2 (x86-64 only)
+
   int num_lines;          // How many lines in this cache
+  int associativity;      // Lines per set (num_lines = fully associative)
+  int num_sets;           // num_lines / associativity
+  int block_words;        // Words per line
+  int* slab;              // num_lines * block_words words of data
+  int* set_mru;           // Per set: index of the most recently used line
+  int* set_lru;           // Per set: index of the replacement victim
   int access_time;        // Time to access this cache (cycles)
   
   // Statistics
   int hits;               // Number of cache hits
   int misses;             // Number of cache misses
+  int writebacks;         // Dirty lines evicted to the level below
+  MissClassifier* classifier;  // 3C breakdown of the misses (NULL = off)
 } Cache;
 
-Cache* cache_create(int num_lines, int access_time);
+Cache* cache_create(int num_lines, int block_words, int access_time);
+Cache* cache_create_assoc(int num_lines, int associativity, int block_words,
+                          int access_time);
 void cache_destroy(Cache* cache);
-CacheLine* cache_search(Cache* cache, int block_address, int word_offset);
-void cache_load(Cache* cache, int block_address, const Block* block, int current_time);
-void cache_write(Cache* cache, int block_address, int word_offset, int value, int current_time);
+CacheLine* cache_search(Cache* cache, uint64_t block_address, int word_offset);
+CacheLine* cache_probe(Cache* cache, uint64_t block_address);
+void cache_touch(Cache* cache, CacheLine* line);
+CacheLine* cache_load(Cache* cache, uint64_t block_address, const int* block,
+                      CacheLine* evicted);
+void cache_invalidate(Cache* cache, CacheLine* line);
+void cache_write(Cache* cache, uint64_t block_address, int word_offset, int value);
 void cache_reset_stats(Cache* cache);
+int cache_classify_misses(Cache* cache);
 
 #endif // CACHE_H
 
@@ -33,13 +74,50 @@ void cache_reset_stats(Cache* cache);
 
 CacheLine:
   valid: Indica se a linha está em uso (1) ou vazia (0)
+  dirty: Linha modificada e ainda não escrita no nível de baixo (write-back)
   tag: Identificador único do bloco da RAM que está armazenado aqui
-  data: Os 4 valores (palavras) do bloco
-  lru_counter: Timestamp da última vez que foi acessada (para LRU)
-  
+  data: As palavras do bloco, dentro do slab da cache (um só malloc para
+        todas as linhas)
+  prefetched/ready_time: Linha trazida por prefetch e ainda não usada, e o
+                        instante (em ciclos da UCM) em que o dado chega
+  state: Estado MESI da linha numa cache privada de um núcleo (smp.h).
+         cache_load não mexe nele (quem carrega escolhe o estado);
+         cache_invalidate o volta para CACHE_INVALID
+
 Cache:
   lines: Array de linhas da cache
+  tags/recency_prev/recency_next: Metadados em arrays separados
+        (estrutura de arrays, alinhados a 64 bytes), então procurar um bloco
+        lê só as tags do conjunto, 8 por linha de cache do host, sem passar
+        pelos dados. Uma linha vazia tem tag CACHE_NO_TAG, que nenhum bloco
+        usa, então a tag sozinha diz se a linha é válida. Em conjuntos com
+        CACHE_SIMD_MIN_WAYS vias ou mais, e se a CPU tiver AVX2, a busca
+        compara 4 tags por instrução (8 por volta); sem AVX2, ou com
+        -DCACHE_SCALAR_SEARCH, compara uma a uma. O resultado é o mesmo.
+        recency_prev/next: vizinhos na lista de recência do conjunto. Cada
+        acesso (cache_touch) move a linha para o início (MRU), então a
+        vítima do LRU é sempre o fim da lista: O(1), sem varredura. A
+        ordem da lista é toda a recência: não há relógio nem timestamps
   num_lines: Quantas linhas tem (L1=8, L2=16, L3=32)
+  associativity: Linhas por conjunto (1 = mapeamento direto,
+                 num_lines = totalmente associativa)
+  num_sets: Quantidade de conjuntos; o conjunto de um bloco é
+            block_address % num_sets
   access_time: Tempo de acesso em ciclos (L1 rápido, L3 lento)
   hits/misses: Estatísticas para o relatório
+  writebacks: Linhas sujas despejadas para o nível de baixo
+  classifier: Divide as faltas em compulsory/capacity/conflict (miss.h);
+              NULL se a classificação estiver desligada
+
+cache_probe: Igual a cache_search, mas sem contar hit/miss (usado para
+             write-backs, que não são acessos do programa)
+cache_load: Retorna a linha que passou a guardar o bloco. Se evicted != NULL,
+            recebe a linha despejada (evicted->valid = 0 se não havia nenhuma),
+            para que a UCM a escreva no nível de baixo se estiver suja. Os
+            dados vão para evicted->data, que quem chama aponta para um
+            buffer de block_words palavras
+cache_classify_misses: Liga a classificação das faltas (cria o classifier).
+                       Retorna 0 ou -1
+cache_invalidate: Esvazia a linha (sem escrever nada) e a põe no fim LRU do
+                  conjunto, para ser a próxima a receber um bloco
 */
\ No newline at end of file
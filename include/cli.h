@@ -0,0 +1,88 @@
+#ifndef CLI_H
+#define CLI_H
+
+#include "stats.h"
+#include "ucm.h"
+
+typedef struct CliOptions {
+  UCMConfig config;       // Hierarchy to build
+  const char* program;    // Name of the program to run
+  int args[2];            // Program arguments
+  int num_args;           // How many were given (0 = program defaults)
+  int help;               // --help was given
+
+  // Design-space sweep (see sweep.h)
+  const char* sweep_file;     // One hierarchy per line
+  const char* grid_lines;     // "8,16/32,64/128": candidates per level
+  const char* grid_latency;
+  const char* grid_assoc;
+  int threads;                // Worker threads (0 = one per core)
+
+  const char* record_path;    // Write the run's accesses to this trace
+  const char* replay_path;    // Drive the hierarchy from this trace
+  const char* save_image;     // Dump the final RAM here
+
+  const char* program_file;   // Run this assembled program (see assembler.h)
+  const char* assemble;       // Assemble this source into `output` and exit
+  const char* output;
+
+  int mrc_lines;              // Print the miss-ratio curve up to this size
+  int histogram;              // Print the access latency histogram
+  const char* heatmap_path;   // Write per-block accesses/misses here (CSV)
+
+  StatsFormat stats_format;   // Box, JSON or CSV report (see stats.h)
+  const char* stats_file;     // Where it goes (NULL = stdout)
+
+  int cores;                  // Simulated CPUs (1 = the single-core UCM)
+} CliOptions;
+
+int cli_parse(int argc, char** argv, CliOptions* options);
+int cli_parse_int_list(const char* value, int* out, int max);
+int cli_set_option(UCMConfig* config, const char* key, const char* value);
+int cli_load_config_file(const char* path, UCMConfig* config);
+void cli_print_usage(const char* exe);
+
+#endif  // CLI_H
+
+/*
+cli_parse: Lê os argumentos da linha de comando. Começa da configuração
+           padrão (ucm_config_default) e aplica as opções na ordem em que
+           aparecem, então "--config arq --lines 8,16,32" usa o arquivo e
+           sobrescreve só as linhas. No fim confere que cada um dos
+           num_levels níveis tem linhas e latência (--lines com 4 valores
+           pede --latency com 4) e diz qual faltou.
+
+--cores N: Roda o programa (ou o trace) em N núcleos com caches privadas
+           e o último nível compartilhado (smp.h). --threads diz quantas
+           threads do host os núcleos usam (padrão: uma por núcleo).
+
+cli_set_option: Aplica uma opção "chave = valor" da hierarquia. As mesmas
+                chaves valem na linha de comando (--chave valor) e no
+                arquivo de configuração (chave = valor, # para comentários).
+
+Exemplo de arquivo:
+  levels = 3
+  lines = 32,64,128
+  assoc = 4,8,16
+  latency = 1,10,50
+  mshrs = 4,8,16
+  block-words = 8
+  ram-latency = 100
+  ram-frames = 4
+  page-words = 16
+  page-policy = clock
+  disk-latency = 10000
+  write-policy = write-back
+  allocate-policy = no-write-allocate
+  inclusion = exclusive
+  fetch = on
+  l1i-lines = 16
+  l1i-assoc = 2
+  l1i-latency = 1
+  victim-lines = 8
+  victim-latency = 2
+  prefetch = stride
+  prefetch-degree = 2
+  prefetch-level = 2
+  classify-misses = on
+*/
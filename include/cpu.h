@@ -5,6 +5,40 @@
 #include "instruction.h"
 #include "ucm.h"  // ← ADD THIS
 
+// Words one instruction takes in memory: opcode, optr1, optr2, optr3
+#define CPU_INSTRUCTION_WORDS 4
+
 void execute_cpu(Register* reg, UCM* ucm, Instruction* memory);  // ← CHANGED
+long cpu_run(Register* reg, UCM* ucm, const Instruction* program, int length,
+             long budget);
+int cpu_code_fits(const RAM* ram, uint64_t code_base, int length);
+void cpu_set_verbose(int verbose);
+
+#endif
+
+/*
+execute_cpu: Executa uma única instrução (a de reg->PC).
+
+cpu_run: Executa a partir de reg->PC até HALT, até sair do programa
+         (length instruções) ou até `budget` instruções (0 = sem limite).
+         Decodifica o programa uma vez (registrador escolhido já embutido
+         na operação) e despacha cada instrução direto para a próxima com
+         goto computado, sem chamada de função nem switch por instrução.
+         Retorna quantas instruções executou; os registradores ficam em
+         reg como se execute_cpu tivesse sido chamado o mesmo número de
+         vezes.
+         Com ucm->fetch ligado, o programa é copiado para a RAM a partir
+         de ucm->code_base (4 palavras por instrução: opcode, optr1..3) e
+         cada instrução é buscada com ucm_access(UCM_FETCH), uma vez por
+         bloco que ela ocupa, antes de executar. O que executa continua
+         sendo a cópia decodificada; a busca só mede o custo.
+         A região do código, [code_base, code_base + 4*length), é
+         reservada: os dados do programa não podem ficar nela, porque a
+         cópia sobrescreve o que estiver lá. Se ela não cabe na RAM,
+         cpu_run não executa nada e retorna -1 (o código nunca é movido
+         para outro lugar).
+         execute_cpu não modela a busca.
 
-#endif
\ No newline at end of file
+cpu_code_fits: 1 se a região do código de um programa com length
+               instruções cabe na RAM a partir de code_base.
+*/
\ No newline at end of file
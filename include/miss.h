@@ -0,0 +1,64 @@
+#ifndef MISS_H
+#define MISS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "blockmap.h"
+
+// Splits one cache's misses into the three Cs
+typedef struct MissClassifier {
+  // Blocks this cache was ever asked for (entries are just block + 1)
+  BlockMap seen;
+
+  // Fully associative LRU cache with as many lines as the real one
+  int lines;
+  int used;
+  uint64_t* shadow_block;
+  int* shadow_prev;       // More recently used (-1 = MRU)
+  int* shadow_next;       // Less recently used (-1 = LRU)
+  int shadow_mru;
+  int shadow_lru;
+  int* shadow_index;      // Block -> line of the shadow (-1 = empty slot)
+  size_t index_capacity;
+
+  // Statistics
+  int compulsory;         // First request for the block
+  int capacity;           // The shadow missed too: the set does not fit
+  int conflict;           // The shadow hit: only the mapping lost it
+  int failed;             // `seen` could not grow: the split stopped
+} MissClassifier;
+
+MissClassifier* miss_classifier_create(int lines);
+void miss_classifier_destroy(MissClassifier* classifier);
+void miss_classifier_record(MissClassifier* classifier, uint64_t block_address,
+                            int hit);
+void miss_classifier_reset_stats(MissClassifier* classifier);
+
+#endif  // MISS_H
+
+/*
+Classificação das faltas de uma cache (os "3 Cs"), para saber o que
+mudar quando a taxa de acerto é ruim:
+
+  compulsory: primeiro pedido do bloco a esta cache; só some com blocos
+              maiores ou prefetch
+  capacity:   uma cache totalmente associativa LRU com o mesmo número de
+              linhas também teria faltado: o conjunto de trabalho não cabe
+  conflict:   a totalmente associativa teria acertado: o bloco saiu por
+              causa do mapeamento (mais vias ou outra indexação resolvem)
+
+miss_classifier_record: Chamado pela cache a cada busca (cache_search),
+                        acerto ou falta. Atualiza o conjunto de blocos já
+                        vistos (tabela hash que cresce) e a cache sombra
+                        (lista LRU + tabela hash, O(1) por acesso) e, se foi
+                        falta, soma em um dos três contadores. Linhas que
+                        entram sem busca (prefetch, cache de vítimas,
+                        promoções da política exclusiva) não passam pela
+                        sombra, então nessas configurações a divisão é uma
+                        aproximação; a soma é sempre igual a misses.
+                        Se faltar memória para a tabela de blocos vistos,
+                        failed fica 1 e a classificação para: os
+                        contadores não valem mais e a UCM não os mostra
+                        (nem zerando as estatísticas volta).
+*/
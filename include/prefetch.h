@@ -0,0 +1,70 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <stdint.h>
+
+#define PREFETCH_MAX_DEGREE 16
+#define PREFETCH_HISTORY 32     // Recent triggers the stride detector keeps
+#define PREFETCH_WINDOW 64      // Largest stride it looks for, in blocks
+#define PREFETCH_VICTIMS 1024   // Blocks remembered as evicted by prefetches
+
+// Which blocks to fetch ahead of a miss
+typedef enum {
+  PREFETCH_NONE,
+  PREFETCH_NEXT_LINE,   // The next `degree` blocks
+  PREFETCH_STRIDE       // `degree` strides ahead once a stream repeats one
+} PrefetchPolicy;
+
+typedef struct Prefetcher {
+  PrefetchPolicy policy;
+  int degree;             // Blocks fetched per trigger
+
+  // Last blocks that triggered the prefetcher (ring buffer)
+  uint64_t history[PREFETCH_HISTORY];
+  int history_count;
+  int history_next;
+
+  // Cache lines evicted by prefetches: key = block * levels + level + 1
+  uint64_t victims[PREFETCH_VICTIMS];
+
+  // Statistics
+  int issued;             // Blocks brought in ahead of time
+  int useful;             // Prefetched lines later used by the program
+  int late;               // ... but used before they had arrived
+  int polluting;          // Demand misses on lines a prefetch evicted
+} Prefetcher;
+
+Prefetcher* prefetcher_create(PrefetchPolicy policy, int degree);
+void prefetcher_destroy(Prefetcher* prefetcher);
+int prefetcher_candidates(Prefetcher* prefetcher, uint64_t block_address,
+                          uint64_t* out);
+void prefetcher_record_victim(Prefetcher* prefetcher, int level, int levels,
+                              uint64_t block_address);
+int prefetcher_was_victim(Prefetcher* prefetcher, int level, int levels,
+                          uint64_t block_address);
+void prefetcher_reset_stats(Prefetcher* prefetcher);
+const char* prefetcher_policy_name(PrefetchPolicy policy);
+
+#endif  // PREFETCH_H
+
+/*
+Prefetcher: decide QUAIS blocos buscar; a UCM é quem busca (ucm.c) e põe o
+bloco no nível escolhido (prefetch_level), marcando a linha como
+"prefetched" com o instante em que o dado chega.
+
+prefetcher_candidates: Chamado a cada falta da L1 e a cada primeiro uso de
+                       uma linha trazida por prefetch (para o fluxo seguir
+                       adiante). Retorna quantos blocos pôs em out.
+    next-line: b+1 ... b+degree
+    stride:    procura entre os últimos PREFETCH_HISTORY gatilhos um passo
+               p (até PREFETCH_WINDOW blocos) com b-p e b-2p ambos
+               presentes, ou seja, um fluxo que já repetiu o passo. Assim
+               acha fluxos intercalados (A[i], B[i], C[i], A[i+1], ...)
+               sem precisar do endereço da instrução. Busca b+p ... b+degree×p
+
+Estatísticas:
+  issued:    blocos buscados antecipadamente
+  useful:    linhas buscadas que o programa usou
+  late:      usadas antes de chegar (o acesso espera o resto da latência)
+  polluting: faltas em blocos que um prefetch tinha expulsado
+*/
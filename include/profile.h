@@ -0,0 +1,66 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "blockmap.h"
+#include "ucm.h"
+
+#define PROFILE_BUCKETS 32    // Bucket b: latencies in [2^(b-1), 2^b)
+
+typedef enum {
+  PROFILE_READ,
+  PROFILE_WRITE,
+  PROFILE_FETCH,
+  PROFILE_KINDS
+} ProfileKind;
+
+// Accesses and L1 misses of one block (block_plus_one = 0: empty slot)
+typedef struct ProfileBlock {
+  uint64_t block_plus_one;
+  uint64_t accesses;
+  uint64_t misses;
+} ProfileBlock;
+
+// Latency of every access seen by ucm_access, and where the cost went
+typedef struct AccessProfile {
+  uint64_t histogram[PROFILE_KINDS][UCM_SOURCES][PROFILE_BUCKETS];
+  uint64_t max_latency[PROFILE_KINDS][UCM_SOURCES];
+
+  // Block -> counters (blocks.entries == NULL: no heatmap)
+  BlockMap blocks;
+} AccessProfile;
+
+AccessProfile* profile_create(int heatmap);
+void profile_destroy(AccessProfile* profile);
+void profile_record(AccessProfile* profile, uint64_t block_address,
+                    UCM_Operation operation, int source, uint64_t latency);
+
+void profile_print_latency(const AccessProfile* profile, FILE* out);
+int profile_write_heatmap(const AccessProfile* profile, const char* path,
+                          int block_words);
+
+#endif  // PROFILE_H
+
+/*
+Perfil dos acessos: a média de total_time esconde a cauda (poucos acessos
+que vão à RAM ou ao disco) e os blocos que causam o custo.
+
+profile_record: Chamado por ucm_access (e pelos acertos de
+                ucm_access_batch) com o tempo que o acesso custou e quem o
+                serviu (source: 0..num_levels-1 = nível, UCM_SOURCE_VICTIM
+                ou UCM_SOURCE_RAM, ver UCM.source). Soma 1 no balde
+                log2(latência) do tipo (leitura, escrita, busca de
+                instrução) e da origem: O(1), sem alocar. Com heatmap,
+                também conta acessos e faltas da L1 (origem != 0) por bloco.
+
+profile_print_latency: Histograma por balde (leituras, escritas, buscas) e
+                       uma linha por tipo e origem com p50/p90/p99 (limite
+                       superior do balde) e o máximo exato.
+
+profile_write_heatmap: Grava um CSV ordenado pelo bloco:
+                       block,first_word,accesses,misses
+                       Retorna 0 ou -1.
+*/
@@ -3,11 +3,29 @@
 
 #include "instruction.h"
 #include "ram.h"
+#include "ucm.h"
 
-void program_mult(RAM* ram, Register* reg, int multiplicand, int multiplier);
-void program_div(RAM* ram, Register* reg, int dividend, int divisor);
-void program_fat(RAM* ram, Register* reg, int n);
-void program_sum_matrix(RAM* ram, Register* reg, int size);
-void program_fibonacci(RAM* ram, Register* reg, int term);
+// Every program runs on a hierarchy built by the caller
+typedef struct ProgramInfo {
+  const char* name;       // Name used on the command line
+  const char* title;      // Name shown in the statistics header
+  void (*run)(UCM* ucm, Register* reg, int arg1, int arg2);
+  int num_args;           // How many of arg1/arg2 the program uses
+  int default_args[2];
+  int result_address;     // RAM word holding the result (-1 = none)
+} ProgramInfo;
 
-#endif  // PROGRAM_H
\ No newline at end of file
+void program_mult(UCM* ucm, Register* reg, int multiplicand, int multiplier);
+void program_div(UCM* ucm, Register* reg, int dividend, int divisor);
+void program_fat(UCM* ucm, Register* reg, int n);
+void program_sum_matrix(UCM* ucm, Register* reg, int size);
+void program_fibonacci(UCM* ucm, Register* reg, int term);
+void program_matrix_mult(UCM* ucm, Register* reg, int size);
+
+const ProgramInfo* program_find(const char* name);
+const ProgramInfo* program_load_file(const char* path);
+void program_unload_file(void);
+void program_set_verbose(int verbose);
+void program_print_list(void);
+
+#endif  // PROGRAM_H
@@ -1,32 +1,141 @@
 #ifndef RAM_H
 #define RAM_H
 
+#include <pthread.h>
 #include <stddef.h>
-#include "block.h"
+#include <stdint.h>
+
+#include "blockmap.h"
+
+#define RAM_PAGE_WORDS 1024               // Allocation unit without swap
+#define RAM_DEFAULT_WORDS (1ULL << 32)    // Address space of a new RAM
+#define RAM_MAX_WORDS (1ULL << 61)        // Largest one (trace deltas fit)
+#define RAM_IMAGE_HEADER_SIZE 32
+
+// Which resident page makes room for a page coming from disk
+typedef enum {
+  RAM_PAGE_LRU,    // Least recently accessed
+  RAM_PAGE_FIFO,   // Loaded longest ago
+  RAM_PAGE_CLOCK   // Second chance over a reference bit
+} RAM_PagePolicy;
+
+// One touched page of the address space
+typedef struct RAMPage {
+  uint64_t number_plus_one;   // 0 = empty slot of the page table
+  int* words;                 // Its data, NULL while it is only on disk
+  long frame;                 // Frame holding it (swap only), -1 if none
+  int on_disk;                // Was written to the swap file
+  int mapped;                 // `words` points into the loaded image
+} RAMPage;
 
 typedef struct RAM {
-    Block* blocks;  
-    size_t num_blocks;
-    size_t num_words;
+    uint64_t num_words;     // Size of the address space
+    size_t page_words;      // Words per page
+
+    // Page table with only the pages touched so far (RAMPage entries)
+    BlockMap pages;
+
+    // Swap (num_frames == 0: every touched page stays in memory)
+    int* frames;            // num_frames pages of storage
+    size_t num_frames;      // Pages that fit in RAM
+    RAM_PagePolicy page_policy;
+    uint64_t* frame_page;   // Frame -> page number it holds
+    unsigned char* frame_used;
+    uint64_t* frame_stamp;  // Last access (LRU) or load time (FIFO)
+    unsigned char* frame_referenced;  // CLOCK reference bit
+    unsigned char* frame_dirty;
+    size_t clock_hand;
+    uint64_t tick;
+    int swap_fd;            // Backing file, removed once opened
+
+    // Image loaded with ram_load_image (read-only; written pages are copied)
+    void* image_map;
+    size_t image_size;
+    int image_fd;
+    const int* image;       // First word of the image
+    uint64_t image_words;
+
+    uint64_t page_faults;   // Accesses to a page that was not resident
+    uint64_t disk_reads;    // Pages read back from the swap file
+    uint64_t disk_writes;   // Dirty pages written to the swap file
+
+    pthread_mutex_t* lock;  // Held by every access (NULL = one thread)
 } RAM;
 
-RAM* create_ram(size_t size);
-RAM* create_empty_ram(size_t size);
-RAM* create_random_ram(size_t size);
+RAM* create_ram(uint64_t size);
+RAM* create_empty_ram(uint64_t size);
+RAM* create_random_ram(uint64_t size);
+RAM* create_swapped_ram(uint64_t size, size_t num_frames, size_t page_words,
+                        RAM_PagePolicy policy);
+
+int get_ram(RAM* ram, uint64_t memory_address);
+void set_ram(RAM* ram, uint64_t memory_address, int new_memory_value);
+void get_ram_words(RAM* ram, uint64_t memory_address, int* dest,
+                   size_t count);
+void set_ram_words(RAM* ram, uint64_t memory_address, const int* src,
+                   size_t count);
 
-int get_ram(RAM* ram, size_t memory_address);
-void set_ram(RAM* ram, size_t memory_address, int new_memory_value);
-void get_ram_block(RAM* ram, size_t block_address, Block* dest);
-void set_ram_block(RAM* ram, size_t block_address, const Block* src);
+int ram_load_image(RAM* ram, const char* path);
+int ram_save_image(RAM* ram, const char* path);
 
 void destroy_ram(RAM* ram);
 
-static inline size_t word_to_block(size_t word_address) {
-  return word_address / WORDS_PER_BLOCK;
+static inline uint64_t ram_disk_operations(const RAM* ram) {
+  return ram->disk_reads + ram->disk_writes;
 }
 
-static inline size_t word_to_offset(size_t word_address) {
-  return word_address % WORDS_PER_BLOCK;
-}
+#endif // RAM_H
+
+/*
+RAM esparsa: o espaço de endereçamento (64 bits, palavras) só ocupa memória
+nas páginas que já foram escritas. Ler uma página que nunca foi escrita
+devolve zeros sem alocar nada, então uma RAM de 2^32 palavras custa o mesmo
+que uma de 100 enquanto o programa tocar poucos endereços.
+
+create_ram: Espaço de `size` palavras em páginas de RAM_PAGE_WORDS.
+            Quem cria a partir da configuração (ucm_create_ram, --ram-words)
+            limita o espaço a RAM_MAX_WORDS: o trace (trace.h) guarda a
+            diferença entre dois endereços em zigzag, deslocada de 2 bits
+            para a operação, num varint de 64 bits.
+
+create_swapped_ram: RAM com só num_frames páginas residentes de page_words
+                    palavras (múltiplo do bloco das caches). As outras ficam
+                    num arquivo de swap em disco ($TMPDIR ou /var/tmp), lido
+                    e escrito com pread/pwrite. Uma página nunca escrita no
+                    disco volta zerada sem ler o arquivo, então só as páginas
+                    que já foram expulsas sujas custam acesso ao disco.
+
+get_ram_words/set_ram_words: Copiam `count` palavras a partir de um
+                             endereço (a UCM move um bloco inteiro de cada
+                             vez). A RAM não sabe o tamanho do bloco, que é
+                             escolhido pela hierarquia (block.h).
+
+ram_load_image: Mapeia (mmap) um arquivo de imagem como conteúdo inicial da
+                RAM em O(1); as páginas só são lidas do arquivo quando o
+                programa as usa. O mapeamento é só leitura: a primeira
+                escrita numa página a copia, então o arquivo nunca muda.
+                A RAM cresce se a imagem for maior.
+
+ram_save_image: Grava o conteúdo atual (inclusive páginas no swap) num
+                arquivo temporário e o renomeia por cima de `path`, então
+                salvar sobre a própria imagem carregada é seguro. O arquivo
+                vai só até a última página usada, e páginas nunca escritas
+                viram buracos (arquivo esparso).
+
+Formato da imagem (inteiros little-endian):
+  "UCMRAM\0\0" | versão (u32) | bytes por palavra (u32, 4) | palavras (u64) |
+  reservado (u64) | palavras da RAM (int32), do endereço 0 em diante
+  A imagem não depende do tamanho de bloco: a RAM guarda palavras e cada
+  hierarquia escolhe o seu (block_words). Na versão 1 o campo depois da
+  versão era palavras por bloco; ram_load_image ainda lê essas imagens e
+  ignora o campo. ram_save_image sempre grava a versão 2.
+
+lock: Com lock != NULL, get_ram/set_ram/get_ram_words/set_ram_words
+      tomam o mutex, então várias threads podem usar a mesma RAM (os
+      núcleos de smp.h, que também escrevem nela direto ao iniciar os
+      dados dos programas). Quem cria o mutex é quem compartilha a RAM.
 
-#endif // RAM_H
\ No newline at end of file
+ram_disk_operations: Leituras + escritas no arquivo de swap até agora; a UCM
+                     compara antes e depois de cada acesso para cobrar o
+                     tempo de disco.
+*/
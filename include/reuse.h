@@ -0,0 +1,72 @@
+#ifndef REUSE_H
+#define REUSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "blockmap.h"
+#include "ucm.h"
+
+// Last access of one block (block_plus_one = 0 marks an empty slot of
+// the BlockMap)
+typedef struct ReuseEntry {
+  uint64_t block_plus_one;
+  size_t time;
+} ReuseEntry;
+
+// Stack-distance histogram of every access seen by ucm_access
+typedef struct ReuseAnalyzer {
+  // Block -> time of its last access; table.count is the blocks touched
+  BlockMap table;
+
+  // Fenwick tree over time: 1 at the last access of each block, so the
+  // blocks touched after time t are `table.count - prefix(t)`
+  int* tree;
+  size_t tree_capacity;
+  size_t time;            // Next free slot; compacted when it runs out
+
+  uint64_t* histogram;    // histogram[d]: accesses at stack distance d
+  int max_distance;       // Distances >= this only go to `beyond`
+  uint64_t beyond;
+  uint64_t cold;          // First touch of a block
+  uint64_t accesses;
+  int failed;             // Ran out of memory: recording stopped there
+} ReuseAnalyzer;
+
+ReuseAnalyzer* reuse_create(int max_distance);
+void reuse_destroy(ReuseAnalyzer* reuse);
+void reuse_record(ReuseAnalyzer* reuse, uint64_t block_address);
+
+double reuse_miss_ratio(const ReuseAnalyzer* reuse, int lines);
+void reuse_print_curve(const ReuseAnalyzer* reuse, FILE* out, int max_lines);
+void reuse_print_levels(const ReuseAnalyzer* reuse, FILE* out,
+                        const UCM* ucm);
+
+#endif  // REUSE_H
+
+/*
+Distância de pilha (reuse distance): quantos blocos diferentes foram
+acessados entre dois acessos ao mesmo bloco. Numa cache totalmente
+associativa LRU com C linhas, o acesso é acerto se e só se a distância < C,
+então um único histograma dá a taxa de falta de todos os tamanhos:
+
+  falta(C) = (frias + acessos com distância >= C) / acessos
+
+reuse_record: O(log n) por acesso. A árvore de Fenwick guarda uma marca no
+              último acesso de cada bloco; quando o tempo chega ao fim da
+              árvore, os blocos são renumerados na ordem em que foram
+              usados, então a memória depende dos blocos distintos e não do
+              tamanho do trace.
+              Se faltar memória (tabela ou árvore), failed fica 1 e os
+              acessos seguintes não são mais contados: a curva cobre só o
+              começo do programa, e as duas impressões avisam isso.
+
+reuse_print_curve: Curva de taxa de falta para 1..N linhas.
+
+reuse_print_levels: Taxa prevista de cada nível da hierarquia (acertos do
+                    nível / acessos que chegaram a ele), ao lado da medida.
+                    A previsão supõe níveis totalmente associativos com
+                    write-allocate; com associatividade ou no-write-allocate
+                    é uma aproximação.
+*/
@@ -0,0 +1,131 @@
+#ifndef SMP_H
+#define SMP_H
+
+#include <pthread.h>
+#include <stdio.h>
+
+#include "instruction.h"
+#include "program.h"
+#include "stats.h"
+#include "trace.h"
+#include "ucm.h"
+
+#define SMP_MAX_CORES 64
+
+// One simulated CPU: its registers, private caches and counters
+typedef struct SmpCore {
+  UCM* ucm;               // Private levels (L1..L(n-1)) and the counters
+  Register reg;
+  pthread_mutex_t lock;   // The private caches (snoops take it too)
+
+  // This core's share of the traffic at the shared level
+  int shared_hits;
+  int shared_misses;
+  int shared_writebacks;  // Dirty shared lines its misses pushed to RAM
+
+  // Coherence traffic this core's accesses caused
+  int invalidations;      // Copies removed from other cores
+  int upgrades;           // Stores to a block it held in S
+  int transfers;          // Misses another core's cache served
+} SmpCore;
+
+// N cores with private caches over one shared last level and RAM
+typedef struct SmpSystem {
+  SmpCore cores[SMP_MAX_CORES];
+  int num_cores;
+  int private_levels;     // Levels each core owns (num_levels - 1)
+
+  Cache* shared;          // Last level, shared by every core
+  RAM* ram;
+  BlockShape block;
+  int ram_latency;
+  int disk_latency;
+
+  pthread_mutex_t bus;    // Shared level, RAM traffic and every snoop
+  pthread_mutex_t ram_lock;  // Installed as ram->lock while the system lives
+  int threads;            // Host threads of the last smp_run
+} SmpSystem;
+
+SmpSystem* smp_create(RAM* ram, const UCMConfig* config, int num_cores);
+void smp_destroy(SmpSystem* smp);
+int smp_access(SmpSystem* smp, int core, uint64_t address,
+               UCM_Operation operation, int value);
+void smp_flush(SmpSystem* smp);
+void smp_reset_core_stats(SmpSystem* smp, int core);
+void smp_run(SmpSystem* smp, const ProgramInfo* program, int arg1, int arg2,
+             const TraceReader* trace, int threads);
+void smp_get_stats(SmpSystem* smp, int core, UCMStats* stats);
+void smp_print_stats(SmpSystem* smp);
+void smp_print_stats_format(SmpSystem* smp, FILE* out, StatsFormat format);
+
+#endif  // SMP_H
+
+/*
+Vários núcleos (--cores N), cada um com seus registradores e suas caches
+privadas (todos os níveis menos o último), dividindo o último nível e a
+RAM. Com a configuração padrão: L1 e L2 por núcleo, L3 compartilhada.
+
+Cada núcleo é uma UCM comum (SmpCore.ucm) criada só com os níveis
+privados, com ucm->smp apontando para o sistema; então os programas, a CPU
+e o replay de traces rodam num núcleo sem mudar nada, e os contadores de
+cada núcleo são os da UCM dele. ucm_access passa o acesso para smp_access.
+
+Coerência (MESI, invalidação, com snoop em todos os núcleos):
+  - O estado fica em CacheLine.state, igual em todas as cópias privadas do
+    núcleo. As caches privadas são sempre write-back com write-allocate e
+    inclusivas (L1 ⊆ L2): a cópia de cima é a mais nova, e um bloco que
+    sai do último nível privado sai das de cima (back_invalidations).
+  - Leitura que falta nas privadas: um núcleo com o bloco em M ou E o
+    entrega (cache-to-cache, transfers); M também o grava no nível
+    compartilhado (ou RAM) e os dois ficam em S. Se ninguém tem, vem do
+    nível compartilhado ou da RAM e entra em E (S se outro núcleo tinha em S).
+  - Escrita que falta: igual, mas as cópias dos outros são invalidadas
+    (invalidations) e o bloco entra em M.
+  - Escrita num bloco em S: upgrade (upgrades), invalida as outras cópias
+    sem mover dados. Em E vira M sem falar com ninguém.
+  O nível compartilhado não é inclusivo: guarda o que veio da RAM e recebe
+  os write-backs dos blocos que ele ainda tem (os outros vão para a RAM).
+
+Tempo: cada núcleo soma a latência dos seus acessos, como a UCM
+bloqueante: níveis privados consultados, + a do nível compartilhado numa
+falta ou upgrade (o snoop acontece junto), + RAM (e disco) se ninguém tinha
+o bloco. Não há disputa pelo barramento no tempo simulado; o relatório dá
+o tempo de cada núcleo e o maior deles (núcleos rodam em paralelo).
+
+Sem fetch de instruções, cache de vítimas, prefetch nem MSHRs: smp_create
+recusa essas configurações. write-policy, allocate-policy e inclusion
+também não se aplicam (ver acima).
+
+Threads do host: um acesso que acerta numa cache privada sem precisar de
+permissão (leitura, ou escrita em M/E) só trava o núcleo (SmpCore.lock),
+então núcleos em threads diferentes rodam em paralelo enquanto acertam.
+Faltas e upgrades soltam o núcleo e pegam o barramento (smp->bus); com
+ele, o snoop trava cada outro núcleo, um de cada vez. As caches do próprio
+núcleo não precisam do lock dele aí: as outras threads só chegam nelas
+por snoops e flushes, que também pegam o barramento. Nunca há dois locks
+de núcleo ao mesmo tempo, então não há deadlock. A RAM ganha um mutex próprio (ram->lock)
+porque os programas também a escrevem direto.
+
+smp_run: Roda o programa (ou o trace, que todos os núcleos reexecutam) em
+         cada núcleo. threads = 0: uma thread por núcleo; 1: os núcleos
+         rodam um depois do outro na thread que chamou, e o resultado é
+         sempre o mesmo. Com mais de uma thread a ordem dos acessos entre
+         núcleos, e portanto os contadores de coerência, muda a cada
+         execução. Os programas rodam sem imprimir (program_set_verbose).
+
+smp_flush: Leva tudo o que está sujo nas caches privadas para o nível
+           compartilhado (ou RAM) e dele para a RAM. Linhas em M viram E.
+           É o que ucm_flush faz quando chamado num núcleo.
+
+smp_reset_core_stats: Zera a parte do núcleo no nível compartilhado e os
+                      contadores de coerência dele (ucm_reset_stats do
+                      núcleo chama).
+
+smp_get_stats: ucm_get_stats do núcleo, com o nível compartilhado como
+               último nível (hits/misses/writebacks só deste núcleo) e os
+               contadores de coerência.
+
+smp_print_stats: Quadro com uma seção por núcleo e os totais.
+smp_print_stats_format: JSON (array, um objeto por núcleo) ou CSV (uma
+                        linha por núcleo, na ordem); box = smp_print_stats.
+*/
@@ -0,0 +1,41 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+#include "ucm.h"
+
+// How a run reports its statistics
+typedef enum {
+  STATS_BOX,              // ucm_print_stats (the default)
+  STATS_JSON,
+  STATS_CSV
+} StatsFormat;
+
+int stats_parse_format(const char* name, StatsFormat* format);
+
+void stats_print_json(FILE* out, const UCMStats* stats);
+void stats_print_csv_header(FILE* out, int levels);
+void stats_print_csv_row(FILE* out, const UCMStats* stats, int levels);
+
+#endif  // STATS_H
+
+/*
+Saída das estatísticas para scripts, sem raspar o quadro de
+ucm_print_stats (que muda de layout). Os dois formatos trazem os mesmos
+campos de UCMStats (ver ucm_get_stats):
+
+stats_print_json: Um objeto em uma linha (sem a quebra de linha no fim):
+  {"accesses": ..., "hits": ..., "misses": ..., "hit_rate": ...,
+   "time": ..., "amat": ..., ..., "caches": [{"lines": ..., "hits": ...,
+   ...}, ...], "l1i": {...} ou null, "victim": {...} ou null}
+  "caches" tem um objeto por nível (L1 primeiro).
+  Taxas são frações (0 a 1). Sem classificação das faltas, compulsory,
+  capacity e conflict saem como null.
+
+stats_print_csv_header/row: Uma linha por execução, com as colunas dos
+  totais, depois l1_*, l2_*, ... até `levels` níveis, l1i_* e victim_*.
+  Campos que a hierarquia não tem (um nível a mais, L1I, vítimas, 3C
+  desligado) ficam vazios, então execuções com hierarquias diferentes
+  cabem no mesmo arquivo com o mesmo cabeçalho.
+*/
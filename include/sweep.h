@@ -0,0 +1,66 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stdio.h>
+
+#include "program.h"
+#include "stats.h"
+#include "trace.h"
+#include "ucm.h"
+
+#define SWEEP_LABEL_SIZE 128
+
+// One hierarchy to evaluate and, after sweep_run, what it measured
+typedef struct SweepPoint {
+  UCMConfig config;
+  char label[SWEEP_LABEL_SIZE];     // Keys of its --sweep line the table
+                                    // has no column for ("" if none)
+
+  int ok;                           // 0 if the hierarchy could not be built
+  UCMStats stats;
+} SweepPoint;
+
+int sweep_load_file(const char* path, const UCMConfig* base,
+                    SweepPoint** points, int* count);
+int sweep_build_grid(const UCMConfig* base, const char* lines_grid,
+                     const char* latency_grid, const char* assoc_grid,
+                     SweepPoint** points, int* count);
+int sweep_default_threads(void);
+void sweep_run(SweepPoint* points, int count, const ProgramInfo* program,
+               int arg1, int arg2, const TraceReader* trace, int threads);
+void sweep_print_table(FILE* out, const SweepPoint* points, int count);
+void sweep_print_stats(FILE* out, const SweepPoint* points, int count,
+                       StatsFormat format);
+
+#endif  // SWEEP_H
+
+/*
+Varredura do espaço de projeto: roda o mesmo programa em várias hierarquias,
+em paralelo. Cada ponto tem sua própria RAM e UCM, então as threads não
+compartilham nada além do contador do próximo ponto.
+
+sweep_load_file: Um ponto por linha, com opções "chave=valor" separadas por
+                 espaço aplicadas sobre a configuração base:
+                   lines=8,16,32 latency=1,10,50
+                   lines=32,64,128 assoc=4,8,16 write-policy=write-back
+
+sweep_build_grid: Produto cartesiano. Cada grade lista os valores de cada
+                  nível separados por '/':
+                    lines  "8,16,32/16,64/32,128,256" → 3×2×3 = 18 pontos
+
+sweep_run: Com trace != NULL, cada ponto reexecuta o trace em vez do programa
+           (o arquivo mapeado é só lido, então é compartilhado pelas threads)
+
+sweep_print_table: Tabela no formato de results_tp2.txt, com as latências
+                   e as vias (associatividade, FA = totalmente
+                   associativa) de cada nível. Se algum ponto de um
+                   --sweep mudou outras chaves (políticas, block-words,
+                   ...), uma última coluna "Opções" as mostra, para que
+                   linhas com a mesma geometria não fiquem iguais.
+
+sweep_print_stats: Todos os contadores de cada ponto em JSON (um array,
+                   um objeto por linha) ou CSV (um cabeçalho e uma linha
+                   por ponto, ver stats.h). Pontos inválidos ficam de fora,
+                   com um aviso em stderr. A classificação 3C fica
+                   desligada nas varreduras (campos vazios/null).
+*/
@@ -0,0 +1,62 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "ucm.h"
+
+#define TRACE_HEADER_SIZE 32
+#define TRACE_BUFFER_SIZE (1 << 16)
+
+// Records every ucm_access of a run into a trace file
+typedef struct TraceWriter {
+  FILE* file;
+  unsigned char buffer[TRACE_BUFFER_SIZE];
+  size_t used;            // Bytes waiting in buffer
+  uint64_t last_address;  // Addresses are stored as deltas from this
+  uint64_t count;         // Records written
+  uint64_t max_address;   // Highest address seen (sizes the replay RAM)
+} TraceWriter;
+
+// A trace file mapped into memory, read-only (shareable across threads)
+typedef struct TraceReader {
+  const unsigned char* data;
+  size_t size;
+  int version;            // Format of the records (see below)
+  uint64_t count;
+  uint64_t max_address;
+} TraceReader;
+
+TraceWriter* trace_writer_open(const char* path);
+void trace_writer_record(TraceWriter* writer, uint64_t address,
+                         UCM_Operation operation, int value);
+int trace_writer_close(TraceWriter* writer);
+
+TraceReader* trace_reader_open(const char* path);
+void trace_reader_close(TraceReader* reader);
+uint64_t trace_replay(const TraceReader* reader, UCM* ucm);
+
+#endif  // TRACE_H
+
+/*
+Formato do arquivo (inteiros little-endian):
+
+  Cabeçalho (32 bytes):
+    "UCMTRACE" | versão (u32) | reservado (u32) | registros (u64) |
+    maior endereço (u64)
+
+  Registro (um por ucm_access):
+    varint( zigzag(endereço - endereço anterior) << 2 | operação )
+    varint( zigzag(valor) )       ← só em UCM_WRITE
+
+  operação: 0 = leitura, 1 = escrita, 2 = busca de instrução. Na versão 1
+  ela ocupava só 1 bit (<< 1, sem buscas); esses arquivos ainda são lidos.
+
+Acessos sequenciais viram deltas pequenos, então a maioria dos registros
+ocupa 1 byte. Leituras e buscas não guardam valor (ucm_access ignora o valor).
+
+trace_replay: Percorre o arquivo mapeado (mmap) chamando ucm_access para cada
+              registro, sem passar pela CPU nem pelos programas.
+*/
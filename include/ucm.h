@@ -2,37 +2,363 @@
 #define UCM_H
 
 #include "cache.h"
+#include "prefetch.h"
 #include "ram.h"
 
+#define UCM_MAX_LEVELS 8
+#define UCM_CODE_BASE (1ULL << 20)  // Where programs are placed (words)
+#define UCM_LATENCY_UNSET (-1)      // Level with no latency given yet
+
+// Who served an access (UCM.source): a level index, or one of these
+#define UCM_SOURCE_VICTIM UCM_MAX_LEVELS
+#define UCM_SOURCE_RAM (UCM_MAX_LEVELS + 1)
+#define UCM_SOURCES (UCM_MAX_LEVELS + 2)
+
 // Operation types
 typedef enum {
   UCM_READ,
-  UCM_WRITE
+  UCM_WRITE,
+  UCM_FETCH               // Instruction fetch: a read through L1I
 } UCM_Operation;
 
+// Write policies
+typedef enum {
+  UCM_WRITE_THROUGH,      // Every store goes down to RAM
+  UCM_WRITE_BACK          // Stores stay in L1; dirty lines go down on eviction
+} UCM_WritePolicy;
+
+// What a store that misses L1 does
+typedef enum {
+  UCM_WRITE_ALLOCATE,     // Fetch the block into the caches, then write it
+  UCM_NO_WRITE_ALLOCATE   // Send the store around L1 to the level below
+} UCM_AllocatePolicy;
+
+// Which levels may hold copies of the same block
+typedef enum {
+  UCM_NINE,         // Misses fill every level, evictions leave the rest alone
+  UCM_INCLUSIVE,    // Evicting a block removes it from the levels above too
+  UCM_EXCLUSIVE     // Each block lives in one level; L1 victims move down
+} UCM_InclusionPolicy;
+
+// Shape of the hierarchy, chosen at startup
+typedef struct UCMConfig {
+  int num_levels;                       // Cache levels (L1 = index 0)
+  int lines[UCM_MAX_LEVELS];            // Lines per level
+  int associativity[UCM_MAX_LEVELS];    // Ways per set (0 = fully associative)
+  int latency[UCM_MAX_LEVELS];          // Access time per level (cycles)
+  int mshrs[UCM_MAX_LEVELS];            // Outstanding misses (L1 0 = blocking)
+  int block_words;                      // Words per line (power of two)
+  int ram_latency;                      // RAM access time (cycles)
+  uint64_t ram_words;                   // Address space (sparse, in words)
+  const char* ram_image;                // Initial contents (NULL = zeros)
+
+  // Disk below RAM (ram_frames == 0: the whole memory fits in RAM)
+  int ram_frames;                       // Pages RAM can hold
+  int page_words;                       // Words per page
+  RAM_PagePolicy page_policy;
+  int disk_latency;                     // Time per page read or written
+
+  UCM_WritePolicy write_policy;
+  UCM_AllocatePolicy allocate_policy;
+  UCM_InclusionPolicy inclusion;
+
+  // Instruction fetch through the hierarchy (fetch == 0: not modeled)
+  int fetch;
+  int l1i_lines;                        // Split L1I (0 = fetch from L1)
+  int l1i_associativity;
+  int l1i_latency;
+  uint64_t code_base;                   // First word of the program
+
+  int victim_lines;                     // Victim cache after L1 (0 = none)
+  int victim_latency;
+
+  PrefetchPolicy prefetch;              // Fetch ahead of L1 misses
+  int prefetch_degree;                  // Blocks per trigger
+  int prefetch_level;                   // Level prefetches go into (1 = L1)
+
+  int classify_misses;                  // Compulsory/capacity/conflict
+} UCMConfig;
+
+// One outstanding miss of a non-blocking cache
+typedef struct UCMMshr {
+  uint64_t block;
+  uint64_t ready;         // When the block arrives (free once it has)
+} UCMMshr;
+
+struct TraceWriter;
+struct ReuseAnalyzer;
+struct AccessProfile;
+struct SmpSystem;
+
 typedef struct UCM {
-  Cache* L1;              // Level 1 cache (fastest)
-  Cache* L2;              // Level 2 cache
-  Cache* L3;              // Level 3 cache (slowest)
+  Cache* levels[UCM_MAX_LEVELS];  // levels[0] = L1 (fastest)
+  int num_levels;
+  BlockShape block;       // Line size shared by every level
+  Cache* l1d;             // Data L1 (levels[0] outside a fetch)
+  Cache* l1i;             // Instruction L1, NULL if L1 is unified
+  int fetch;              // CPU fetches instructions through the UCM
+  uint64_t code_base;
   RAM* ram;               // Main memory
-  
-  int global_time;        // Global timestamp for LRU
-  
+  int ram_latency;        // Time to access RAM (cycles)
+  int disk_latency;       // Time per page moved to or from disk
+
+  UCM_WritePolicy write_policy;
+  UCM_AllocatePolicy allocate_policy;
+  UCM_InclusionPolicy inclusion;
+
+  Cache* victim;          // Fully associative, holds L1 evictions (or NULL)
+
+  Prefetcher* prefetcher; // NULL = no prefetching
+  int prefetch_level;     // Index of the level prefetches fill
+  int prefetch_pending;   // Set by a miss or a useful prefetch...
+  uint64_t prefetch_block;  // ... on this block; run after the access
+
+  int source;             // Who served the last access (UCM_SOURCE_*)
+
+  // Non-blocking timing (nonblocking == 0: each access waits for the last)
+  int nonblocking;
+  UCMMshr* mshrs[UCM_MAX_LEVELS]; // Per level, NULL = no limit
+  int mshr_count[UCM_MAX_LEVELS];
+  int overlap_depth;      // Inside ucm_overlap_begin/ucm_overlap_end
+  uint64_t clock;         // Elapsed time, instruction fetches included
+  uint64_t next_issue;    // Earliest issue of the next overlapped access
+  uint64_t overlap_end;   // Latest completion among the overlapped ones
+  uint64_t miss_end;      // Until when some primary miss is outstanding
+
   // Global statistics
   int total_accesses;     // Total memory accesses
   int total_hits;         // Total cache hits (any level)
   int total_misses;       // Total cache misses (had to go to RAM)
-  
+  int disk_accesses;      // Accesses that also had to wait for the disk
+
+  // Write statistics
+  int write_accesses;     // Stores issued
+  int write_misses;       // Stores that missed L1
+  int write_allocates;    // Write misses that filled the caches
+  int write_arounds;      // Write misses sent around L1
+
+  int back_invalidations; // Upper copies removed by an inclusive eviction
+
+  // L1D lines ucm_access_batch has seen, by block (checked before use)
+  CacheLine** batch_lines;
+  uint64_t batch_mask;
+
+  // Instruction fetches (kept out of the totals above, which are data)
+  int fetch_accesses;
+  int fetch_hits;         // Found in some cache
+  int fetch_misses;       // Had to go to RAM
+  uint64_t fetch_time;
+
   // Time statistics (cycles)
-  int total_time;         // Total time spent on memory accesses
+  uint64_t total_time;    // Total time spent on memory accesses
+
+  // Memory-level parallelism (non-blocking timing only)
+  int mshr_merges;        // Accesses that joined a miss already in flight
+  int mshr_stalls;        // Misses that waited for a free MSHR
+  uint64_t miss_cycles;   // Sum of the primary misses' latencies
+  uint64_t miss_busy;     // Cycles with at least one primary miss in flight
+
+  struct TraceWriter* trace;  // Records every access when not NULL
+  struct ReuseAnalyzer* reuse;  // Stack-distance histogram when not NULL
+  struct AccessProfile* profile;  // Latency histogram/heatmap when not NULL
+
+  struct SmpSystem* smp;  // Multi-core system this is a core of (or NULL)
+  int core;               // Index of that core
 } UCM;
 
+// One cache's counters, as ucm_get_stats copies them
+typedef struct CacheStats {
+  int lines;
+  int associativity;
+  int latency;
+  int hits;
+  int misses;
+  int writebacks;
+  int classified;         // compulsory/capacity/conflict are filled in
+  int compulsory;
+  int capacity;
+  int conflict;
+} CacheStats;
+
+// Every counter of the hierarchy in a plain struct (emitters: stats.h)
+typedef struct UCMStats {
+  int num_levels;
+  CacheStats levels[UCM_MAX_LEVELS];
+  int has_l1i;
+  CacheStats l1i;
+  int has_victim;
+  CacheStats victim;
+
+  int total_accesses;
+  int total_hits;
+  int total_misses;
+  uint64_t total_time;
+  double hit_rate;        // total_hits / total_accesses
+  double amat;            // total_time / total_accesses (cycles)
+
+  int disk_accesses;
+  uint64_t page_faults;
+  uint64_t disk_reads;
+  uint64_t disk_writes;
+
+  int write_accesses;
+  int write_misses;
+  int write_allocates;
+  int write_arounds;
+  int back_invalidations;
+  int unique_blocks;      // -1 if they could not be counted
+  int cached_lines;
+
+  int fetch_accesses;
+  int fetch_hits;
+  int fetch_misses;
+  uint64_t fetch_time;
+  double fetch_amat;
+
+  int mshr_merges;
+  int mshr_stalls;
+  double mlp;             // Primary misses in flight, on average, while any is
+
+  // Coherence (cores of a multi-core system only, see smp.h)
+  int invalidations;      // Copies in other cores removed by this core
+  int upgrades;           // Stores to a shared copy (no data moved)
+  int transfers;          // Misses served by another core's cache
+
+  int has_prefetch;
+  int prefetch_issued;
+  int prefetch_useful;
+  int prefetch_late;
+  int prefetch_polluting;
+
+  // Policies, spelled as the configuration keys take them
+  const char* write_policy;
+  const char* allocate_policy;
+  const char* inclusion;
+} UCMStats;
+
+void ucm_config_default(UCMConfig* config);
 UCM* ucm_create(RAM* ram);
+UCM* ucm_create_with_config(RAM* ram, const UCMConfig* config);
+RAM* ucm_create_ram(const UCMConfig* config, uint64_t num_words);
 
 void ucm_destroy(UCM* ucm);
-int ucm_access(UCM* ucm, int address, UCM_Operation operation, int value);
+void ucm_flush(UCM* ucm);
+int ucm_access(UCM* ucm, uint64_t address, UCM_Operation operation, int value);
+size_t ucm_access_batch(UCM* ucm, const uint64_t* addresses,
+                        const UCM_Operation* operations, const int* values,
+                        int* results, size_t count);
 void ucm_reset_stats(UCM* ucm);
 void ucm_print_stats(UCM* ucm);
+void ucm_get_stats(const UCM* ucm, UCMStats* stats);
 double ucm_get_hit_rate(UCM* ucm);
+void ucm_overlap_begin(UCM* ucm);
+void ucm_overlap_end(UCM* ucm);
+
+#endif // UCM_H
+
+/*
+UCMConfig:
+  Descreve a hierarquia em tempo de execução (sem recompilar):
+  número de níveis, linhas, associatividade e latência de cada nível,
+  latência da RAM e políticas de escrita. ucm_config_default preenche a
+  configuração original (L1=32/1, L2=64/10, L3=128/50, RAM=100 ciclos,
+  blocos de 4 palavras). block_words vale para todos os níveis e precisa
+  ser potência de dois (e dividir page_words quando há disco).
+
+  Os níveis além do terceiro começam sem linhas e com latency =
+  UCM_LATENCY_UNSET: quem pede mais níveis precisa dar linhas e latência
+  para eles. ucm_create_with_config recusa nível sem linhas e latência
+  negativa (ou não dada), e também ram_latency, disk_latency, l1i_latency
+  ou victim_latency negativas; cli_parse diz qual das duas faltou.
+
+  Com ram_frames > 0 existe um disco abaixo da RAM: ucm_create_ram cria a
+  RAM com só ram_frames páginas residentes e cada página lida ou escrita no
+  arquivo de swap custa disk_latency ciclos no acesso que a provocou.
+  Com ram_image, a RAM começa com o conteúdo da imagem (ram_load_image).
+
+  inclusion: NINE (padrão) é o comportamento original: uma falta enche
+  todos os níveis, mas cada nível despeja por conta própria, então a L1 pode
+  ter blocos que a L3 já não tem. INCLUSIVE mantém L1 ⊆ L2 ⊆ L3: quem
+  despeja um bloco o invalida nos níveis de cima (back-invalidation),
+  levando para baixo a cópia mais nova se alguma estiver suja. EXCLUSIVE
+  guarda cada bloco num nível só: faltas enchem só a L1, um acerto num
+  nível de baixo move o bloco para a L1 e cada vítima desce um nível (sem
+  custo de tempo; só o que sai da última vai para a RAM). A capacidade
+  passa a ser L1+L2+L3; o relatório mostra quantos blocos distintos as
+  caches guardam.
+
+  fetch: A CPU (cpu_run) copia o programa para a RAM em code_base (4
+  palavras por instrução) e busca cada instrução com ucm_access(UCM_FETCH)
+  antes de executá-la. Com l1i_lines > 0 a busca usa uma L1 só de
+  instruções, que divide L2/L3 com os dados; durante a busca ela ocupa o
+  lugar de levels[0], então falta, cache de vítimas, inclusão e prefetch
+  servem às duas L1 sem código à parte. As buscas têm contadores e tempo
+  próprios (fetch_*); total_* continua sendo só dos dados. Escritas no
+  código não invalidam a L1I (não há código automodificável).
+  code_base precisa estar dentro da RAM (ucm_create_with_config recusa),
+  e a região do código é reservada: ver cpu_run em cpu.h.
+
+  victim_lines: Cache de vítimas entre a L1 e a L2, totalmente associativa.
+  Recebe as linhas que a L1 despeja (sujas continuam sujas) e é consultada
+  junto com a L2 quando a L1 falha: num acerto custa só victim_latency e o
+  bloco troca de lugar com a vítima da L1. As linhas sujas que ela despeja
+  descem para a L2 (ou RAM) como um write-back da L1.
+
+  prefetch: A cada falta da L1 o prefetcher (prefetch.h) escolhe blocos que
+  a UCM busca, depois que o acesso termina, e põe em prefetch_level e nos
+  níveis entre ele e quem tinha o bloco. O tempo da busca não é cobrado do
+  programa; só um uso antes de o dado chegar (late) espera o que falta.
+
+  mshrs: Caches não bloqueantes. Com mshrs[0] > 0 cada nível tem esse
+  número de MSHRs (0 abaixo da L1 = sem limite) e o tempo deixa de ser a
+  soma das latências: os acessos entre ucm_overlap_begin e ucm_overlap_end
+  (os dois operandos de ADD/SUB/MUL/DIV, as leituras de um produto
+  escalar) saem um por ciclo e se sobrepõem. Uma falta primária ocupa um
+  MSHR em cada nível em que faltou até o bloco chegar; sem MSHR livre ela
+  espera (mshr_stalls). Um acesso a um bloco que ainda está chegando na L1
+  se junta à falta em andamento (mshr_merges) e termina quando ela
+  terminar. Fora desses grupos cada acesso espera o anterior, como no modo
+  bloqueante. O relatório mostra o MLP alcançado: soma das latências das
+  faltas primárias / ciclos com pelo menos uma em andamento.
+
+  classify_misses: Cada cache (níveis, L1I e vítimas) divide suas faltas
+  em compulsory, capacity e conflict (miss.h), e o relatório mostra a
+  divisão. Desligado por padrão: custa uma busca numa cache sombra por
+  acesso a cada nível, mais da metade do tempo de replay.
+
+UCM:
+  levels: Caches em ordem, levels[0] é a L1 e levels[num_levels-1] a última
+          antes da RAM
+  smp/core: Núcleo de um sistema multi-core (smp.h). Nesse caso levels
+            são só as caches privadas do núcleo, e ucm_access,
+            ucm_access_batch e ucm_flush passam para o smp, que cuida do
+            nível compartilhado e da coerência; os contadores continuam
+            sendo os da UCM (por núcleo).
+  source: Quem serviu o último acesso: o nível onde o bloco estava (0 = L1,
+          também nos acertos de escrita write-through, que ainda pagam a
+          RAM), UCM_SOURCE_VICTIM ou UCM_SOURCE_RAM. O profile usa para
+          separar o histograma de latência
+
+ucm_overlap_begin/ucm_overlap_end: Marcam acessos independentes entre si
+                                   (nenhum usa o resultado de outro). Sem
+                                   MSHRs não fazem nada. Podem ser
+                                   aninhados; o tempo avança no último end.
+
+ucm_get_stats: Copia todos os contadores (os mesmos do relatório de
+               ucm_print_stats) para stats, sem imprimir nada. É a base das
+               saídas JSON/CSV (stats.h) e das varreduras. Os contadores de
+               coerência (invalidations, upgrades, transfers) ficam em 0;
+               quem os preenche é smp_get_stats.
 
-#endif // UCM_H
\ No newline at end of file
+ucm_access_batch: O mesmo que chamar ucm_access para cada i, na ordem
+                  (operations NULL = só leituras, values NULL = zeros;
+                  results recebe o valor lido, pode ser NULL). Guarda as
+                  linhas da L1 que os lotes usaram, indexadas pelo bloco
+                  (tabela do tamanho da L1, mantida entre chamadas); um acesso a um desses blocos que seria um acerto
+                  simples da L1 (leitura, ou escrita com write-back, sem
+                  prefetch pendente) é resolvido ali mesmo, sem procurar no
+                  conjunto nem passar pelas outras funções. A linha é
+                  conferida (válida e com a mesma tag) antes do uso, então
+                  estatísticas e tempos são idênticos aos de ucm_access.
+                  Retorna quantos acessos fez.
+*/
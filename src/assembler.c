@@ -0,0 +1,710 @@
+#define _POSIX_C_SOURCE 200809L  // mmap, getline
+
+#include "include/assembler.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "include/opcodes.h"
+
+#define PROGRAM_MAGIC "UCMPROG"
+#define PROGRAM_VERSION 1
+#define PROGRAM_MAX_RECORD 50  // Opcode and three operands, 10 bytes each
+
+// Mnemonics and how many operands each one takes
+typedef struct Mnemonic {
+  const char* name;
+  int opcode;
+  int operands;
+} Mnemonic;
+
+static const Mnemonic mnemonics[] = {
+    {"HALT", HALT, 0},
+    {"ADD", ADD, 3},
+    {"SUB", SUB, 3},
+    {"MUL", MUL, 3},
+    {"DIV", DIV, 3},
+    {"COPY_REG_RAM", COPY_REG_RAM, 2},
+    {"COPY_RAM_REG", COPY_RAM_REG, 2},
+    {"COPY_EXT_REG", COPY_EXT_REG, 2},
+    {"OBTAIN_REG", OBTAIN_REG, 2},
+    {"JUMP", JUMP, 1},
+    {"JZ", JZ, 1},
+    {"JNZ", JNZ, 1},
+    {"JGT", JGT, 1},
+    {"JLT", JLT, 1},
+};
+
+#define NUM_MNEMONICS (int)(sizeof(mnemonics) / sizeof(mnemonics[0]))
+
+static const Mnemonic* mnemonic_find(const char* name) {
+  for (int i = 0; i < NUM_MNEMONICS; i++) {
+    const char* a = mnemonics[i].name;
+    const char* b = name;
+    while (*a != '\0' && toupper((unsigned char)*b) == *a) {
+      a++;
+      b++;
+    }
+    if (*a == '\0' && *b == '\0') return &mnemonics[i];
+  }
+  return NULL;
+}
+
+// Operands the CPU reads for an opcode (unknown opcodes keep all three)
+static int opcode_operands(int opcode) {
+  for (int i = 0; i < NUM_MNEMONICS; i++) {
+    if (mnemonics[i].opcode == opcode) return mnemonics[i].operands;
+  }
+  return 3;
+}
+
+static void put_u32(unsigned char* out, uint32_t value) {
+  for (int i = 0; i < 4; i++) out[i] = (unsigned char)(value >> (8 * i));
+}
+
+static void put_u64(unsigned char* out, uint64_t value) {
+  for (int i = 0; i < 8; i++) out[i] = (unsigned char)(value >> (8 * i));
+}
+
+static uint32_t get_u32(const unsigned char* in) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; i++) value |= (uint32_t)in[i] << (8 * i);
+  return value;
+}
+
+static uint64_t get_u64(const unsigned char* in) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; i++) value |= (uint64_t)in[i] << (8 * i);
+  return value;
+}
+
+static uint64_t zigzag_encode(int64_t value) {
+  return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t zigzag_decode(uint64_t value) {
+  return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static size_t varint_encode(unsigned char* out, uint64_t value) {
+  size_t n = 0;
+  while (value >= 0x80) {
+    out[n++] = (unsigned char)(value | 0x80);
+    value >>= 7;
+  }
+  out[n++] = (unsigned char)value;
+  return n;
+}
+
+// Returns bytes consumed, 0 if the varint runs past the end
+static size_t varint_decode(const unsigned char* in, size_t available,
+                            uint64_t* value) {
+  uint64_t result = 0;
+  for (size_t n = 0; n < available && n < 10; n++) {
+    result |= (uint64_t)(in[n] & 0x7F) << (7 * n);
+    if ((in[n] & 0x80) == 0) {
+      *value = result;
+      return n + 1;
+    }
+  }
+  return 0;
+}
+
+// Growable byte buffer for the encoded data runs
+typedef struct ByteBuffer {
+  unsigned char* bytes;
+  size_t used;
+  size_t capacity;
+} ByteBuffer;
+
+static int buffer_reserve(ByteBuffer* buffer, size_t extra) {
+  if (buffer->used + extra <= buffer->capacity) return 0;
+
+  size_t capacity = (buffer->capacity > 0) ? buffer->capacity : 4096;
+  while (capacity < buffer->used + extra) capacity *= 2;
+
+  unsigned char* bytes = (unsigned char*)realloc(buffer->bytes, capacity);
+  if (bytes == NULL) return -1;
+
+  buffer->bytes = bytes;
+  buffer->capacity = capacity;
+  return 0;
+}
+
+static int buffer_put_varint(ByteBuffer* buffer, uint64_t value) {
+  if (buffer_reserve(buffer, 10) != 0) return -1;
+  buffer->used += varint_encode(buffer->bytes + buffer->used, value);
+  return 0;
+}
+
+// Label name -> instruction index (open addressing)
+typedef struct Label {
+  char* name;             // NULL = empty slot
+  int index;
+} Label;
+
+// Operand naming a label, patched once every label is known
+typedef struct Fixup {
+  int instruction;
+  int operand;            // 0..2, or -1 for a .word value
+  size_t data_offset;     // Where the .word value goes (operand == -1)
+  char* name;
+  int line;
+} Fixup;
+
+typedef struct Assembler {
+  const char* path;
+  int line;
+
+  Instruction* code;
+  int length;
+  int capacity;
+
+  Label* labels;
+  size_t label_capacity;
+  size_t label_count;
+
+  Fixup* fixups;
+  size_t fixup_count;
+  size_t fixup_capacity;
+
+  // .word values before encoding: (address, value) pairs in order
+  int64_t* words;
+  size_t word_count;
+  size_t word_capacity;
+
+  int64_t result_address;
+} Assembler;
+
+static void assembler_error(const Assembler* as, const char* message,
+                            const char* token) {
+  fprintf(stderr, "%s:%d: %s", as->path, as->line, message);
+  if (token != NULL) fprintf(stderr, " '%s'", token);
+  fprintf(stderr, "\n");
+}
+
+static size_t label_hash(const char* name) {
+  size_t h = 5381;
+  while (*name != '\0') h = h * 33 + (unsigned char)*name++;
+  return h;
+}
+
+static Label* label_slot(Label* table, size_t capacity, const char* name) {
+  size_t mask = capacity - 1;
+  size_t i = label_hash(name) & mask;
+  while (table[i].name != NULL && strcmp(table[i].name, name) != 0) {
+    i = (i + 1) & mask;
+  }
+  return &table[i];
+}
+
+static int label_grow(Assembler* as) {
+  size_t capacity = (as->label_capacity > 0) ? as->label_capacity * 2 : 256;
+  Label* table = (Label*)calloc(capacity, sizeof(Label));
+  if (table == NULL) return -1;
+
+  for (size_t i = 0; i < as->label_capacity; i++) {
+    if (as->labels[i].name != NULL) {
+      *label_slot(table, capacity, as->labels[i].name) = as->labels[i];
+    }
+  }
+
+  free(as->labels);
+  as->labels = table;
+  as->label_capacity = capacity;
+  return 0;
+}
+
+static int label_define(Assembler* as, const char* name) {
+  if (2 * (as->label_count + 1) > as->label_capacity && label_grow(as) != 0) {
+    return -1;
+  }
+
+  Label* slot = label_slot(as->labels, as->label_capacity, name);
+  if (slot->name != NULL) {
+    assembler_error(as, "label defined twice", name);
+    return -1;
+  }
+
+  slot->name = strdup(name);
+  if (slot->name == NULL) return -1;
+  slot->index = as->length;
+  as->label_count++;
+  return 0;
+}
+
+static const Label* label_find(const Assembler* as, const char* name) {
+  if (as->label_capacity == 0) return NULL;
+
+  const Label* slot = label_slot(as->labels, as->label_capacity, name);
+  return (slot->name != NULL) ? slot : NULL;
+}
+
+static int is_identifier(const char* token) {
+  if (!isalpha((unsigned char)*token) && *token != '_') return 0;
+  for (const char* c = token; *c != '\0'; c++) {
+    if (!isalnum((unsigned char)*c) && *c != '_') return 0;
+  }
+  return 1;
+}
+
+static int parse_number(const char* token, int64_t* out) {
+  char* end;
+  errno = 0;
+  long long value = strtoll(token, &end, 0);
+  if (end == token || *end != '\0' || errno != 0) return -1;
+
+  *out = value;
+  return 0;
+}
+
+static int add_fixup(Assembler* as, int instruction, int operand,
+                     size_t data_offset, const char* name) {
+  if (as->fixup_count == as->fixup_capacity) {
+    size_t capacity = (as->fixup_capacity > 0) ? as->fixup_capacity * 2 : 64;
+    Fixup* fixups = (Fixup*)realloc(as->fixups, capacity * sizeof(Fixup));
+    if (fixups == NULL) return -1;
+    as->fixups = fixups;
+    as->fixup_capacity = capacity;
+  }
+
+  Fixup* fixup = &as->fixups[as->fixup_count];
+  fixup->name = strdup(name);
+  if (fixup->name == NULL) return -1;
+  fixup->instruction = instruction;
+  fixup->operand = operand;
+  fixup->data_offset = data_offset;
+  fixup->line = as->line;
+  as->fixup_count++;
+  return 0;
+}
+
+// Number or label; labels are left at 0 and patched later
+static int parse_operand(Assembler* as, const char* token, int instruction,
+                         int operand, size_t data_offset, int64_t* out) {
+  if (parse_number(token, out) == 0) {
+    if (*out < INT_MIN || *out > INT_MAX) {
+      assembler_error(as, "operand out of range", token);
+      return -1;
+    }
+    return 0;
+  }
+  if (!is_identifier(token)) {
+    assembler_error(as, "invalid operand", token);
+    return -1;
+  }
+
+  *out = 0;
+  return add_fixup(as, instruction, operand, data_offset, token);
+}
+
+static int add_word(Assembler* as, int64_t address, int64_t value) {
+  if (as->word_count + 2 > as->word_capacity) {
+    size_t capacity = (as->word_capacity > 0) ? as->word_capacity * 2 : 256;
+    int64_t* words = (int64_t*)realloc(as->words, capacity * sizeof(int64_t));
+    if (words == NULL) return -1;
+    as->words = words;
+    as->word_capacity = capacity;
+  }
+
+  as->words[as->word_count++] = address;
+  as->words[as->word_count++] = value;
+  return 0;
+}
+
+static int assemble_result(Assembler* as, char** tokens, int count) {
+  if (count != 2 || parse_number(tokens[1], &as->result_address) != 0 ||
+      as->result_address < 0) {
+    assembler_error(as, "expected .result ADDRESS", NULL);
+    return -1;
+  }
+  return 0;
+}
+
+// .word ADDRESS VALUE...: values are taken one by one, so a line may be
+// as long as the generator likes
+static int assemble_words(Assembler* as, char* rest) {
+  const char* separators = " \t\r\n,";
+  char* token = strtok(rest, separators);
+
+  int64_t address;
+  if (token == NULL || parse_number(token, &address) != 0 || address < 0) {
+    assembler_error(as, "expected .word ADDRESS VALUE...", NULL);
+    return -1;
+  }
+
+  int values = 0;
+  while ((token = strtok(NULL, separators)) != NULL) {
+    int64_t value;
+    if (parse_operand(as, token, -1, -1, as->word_count + 1, &value) != 0 ||
+        add_word(as, address + values, value) != 0) {
+      return -1;
+    }
+    values++;
+  }
+
+  if (values == 0) {
+    assembler_error(as, "expected .word ADDRESS VALUE...", NULL);
+    return -1;
+  }
+  return 0;
+}
+
+static int assemble_instruction(Assembler* as, char** tokens, int count) {
+  const Mnemonic* mnemonic = mnemonic_find(tokens[0]);
+  if (mnemonic == NULL) {
+    assembler_error(as, "unknown instruction", tokens[0]);
+    return -1;
+  }
+  if (count - 1 != mnemonic->operands) {
+    fprintf(stderr, "%s:%d: %s takes %d operand%s\n", as->path, as->line,
+            mnemonic->name, mnemonic->operands,
+            mnemonic->operands == 1 ? "" : "s");
+    return -1;
+  }
+  if (as->length == INT_MAX) {
+    assembler_error(as, "too many instructions", NULL);
+    return -1;
+  }
+
+  if (as->length == as->capacity) {
+    int capacity = (as->capacity > 0) ? as->capacity : 1024;
+    if (capacity > INT_MAX / 2) {
+      capacity = INT_MAX;
+    } else {
+      capacity *= 2;
+    }
+    Instruction* code =
+        (Instruction*)realloc(as->code, (size_t)capacity * sizeof(Instruction));
+    if (code == NULL) return -1;
+    as->code = code;
+    as->capacity = capacity;
+  }
+
+  int64_t operands[3] = {0, 0, 0};
+  for (int i = 1; i < count; i++) {
+    if (parse_operand(as, tokens[i], as->length, i - 1, 0, &operands[i - 1]) !=
+        0) {
+      return -1;
+    }
+  }
+
+  as->code[as->length++] =
+      (Instruction){mnemonic->opcode, (int)operands[0], (int)operands[1],
+                    (int)operands[2]};
+  return 0;
+}
+
+static int assemble_line(Assembler* as, char* text) {
+  const char* separators = " \t\r\n,";
+  char* comment = strpbrk(text, "#;");
+  if (comment != NULL) *comment = '\0';
+
+  char* tokens[5];  // Mnemonic and up to three operands, plus one extra
+  int count = 0;
+  for (char* token = strtok(text, separators); token != NULL;
+       token = strtok(NULL, separators)) {
+    size_t length = strlen(token);
+
+    // "label:" may be followed by an instruction on the same line
+    if (count == 0 && length > 1 && token[length - 1] == ':') {
+      token[length - 1] = '\0';
+      if (!is_identifier(token)) {
+        assembler_error(as, "invalid label", token);
+        return -1;
+      }
+      if (label_define(as, token) != 0) return -1;
+      continue;
+    }
+
+    if (count == 0 && strcmp(token, ".word") == 0) {
+      return assemble_words(as, NULL);
+    }
+
+    if (count == (int)(sizeof(tokens) / sizeof(tokens[0]))) {
+      assembler_error(as, "too many operands", NULL);
+      return -1;
+    }
+    tokens[count++] = token;
+  }
+
+  if (count == 0) return 0;
+  if (strcmp(tokens[0], ".result") == 0) {
+    return assemble_result(as, tokens, count);
+  }
+  if (tokens[0][0] == '.') {
+    assembler_error(as, "unknown directive", tokens[0]);
+    return -1;
+  }
+  return assemble_instruction(as, tokens, count);
+}
+
+static int assembler_resolve(Assembler* as) {
+  int status = 0;
+
+  for (size_t i = 0; i < as->fixup_count; i++) {
+    Fixup* fixup = &as->fixups[i];
+    const Label* label = label_find(as, fixup->name);
+    if (label == NULL) {
+      fprintf(stderr, "%s:%d: undefined label '%s'\n", as->path, fixup->line,
+              fixup->name);
+      status = -1;
+      continue;
+    }
+
+    if (fixup->operand < 0) {
+      as->words[fixup->data_offset] = label->index;
+      continue;
+    }
+
+    Instruction* inst = &as->code[fixup->instruction];
+    int* operands[3] = {&inst->optr1, &inst->optr2, &inst->optr3};
+    *operands[fixup->operand] = label->index;
+  }
+
+  return status;
+}
+
+static int assembler_write(const Assembler* as, const char* output_path) {
+  FILE* file = fopen(output_path, "wb");
+  if (file == NULL) return -1;
+
+  unsigned char header[PROGRAM_HEADER_SIZE] = {0};
+  memcpy(header, PROGRAM_MAGIC, 8);
+  put_u32(header + 8, PROGRAM_VERSION);
+  put_u64(header + 16, (uint64_t)as->length);
+  put_u64(header + 24, (uint64_t)(as->result_address + 1));
+  fwrite(header, 1, sizeof(header), file);
+
+  unsigned char record[PROGRAM_MAX_RECORD];
+  for (int i = 0; i < as->length; i++) {
+    const Instruction* inst = &as->code[i];
+    const int operands[3] = {inst->optr1, inst->optr2, inst->optr3};
+
+    size_t n = varint_encode(record, zigzag_encode(inst->opcode));
+    for (int j = 0; j < opcode_operands(inst->opcode); j++) {
+      n += varint_encode(record + n, zigzag_encode(operands[j]));
+    }
+    fwrite(record, 1, n, file);
+  }
+
+  // Consecutive addresses are grouped into one run
+  ByteBuffer data = {NULL, 0, 0};
+  int status = 0;
+  size_t i = 0;
+  while (i < as->word_count && status == 0) {
+    size_t end = i + 2;
+    while (end < as->word_count && as->words[end] == as->words[end - 2] + 1) {
+      end += 2;
+    }
+
+    status |= buffer_put_varint(&data, (uint64_t)as->words[i]);
+    status |= buffer_put_varint(&data, (uint64_t)((end - i) / 2));
+    for (size_t j = i; j < end && status == 0; j += 2) {
+      status |= buffer_put_varint(&data, zigzag_encode(as->words[j + 1]));
+    }
+    i = end;
+  }
+  if (data.used > 0) fwrite(data.bytes, 1, data.used, file);
+  free(data.bytes);
+
+  if (ferror(file)) status = -1;
+  if (fclose(file) != 0) status = -1;
+  return status;
+}
+
+static void assembler_free(Assembler* as) {
+  for (size_t i = 0; i < as->label_capacity; i++) free(as->labels[i].name);
+  for (size_t i = 0; i < as->fixup_count; i++) free(as->fixups[i].name);
+  free(as->labels);
+  free(as->fixups);
+  free(as->code);
+  free(as->words);
+}
+
+int assembler_build(const char* source_path, const char* output_path) {
+  if (source_path == NULL || output_path == NULL) return -1;
+
+  FILE* source = fopen(source_path, "r");
+  if (source == NULL) {
+    fprintf(stderr, "Error: could not open '%s'\n", source_path);
+    return -1;
+  }
+
+  Assembler as;
+  memset(&as, 0, sizeof(as));
+  as.path = source_path;
+  as.result_address = -1;
+
+  char* text = NULL;
+  size_t text_capacity = 0;
+  int status = 0;
+  while (status == 0 && getline(&text, &text_capacity, source) != -1) {
+    as.line++;
+    status = assemble_line(&as, text);
+  }
+  free(text);
+  fclose(source);
+
+  if (status == 0) status = assembler_resolve(&as);
+  if (status == 0 && as.length == 0) {
+    fprintf(stderr, "%s: no instructions\n", source_path);
+    status = -1;
+  }
+  if (status == 0 && assembler_write(&as, output_path) != 0) {
+    fprintf(stderr, "Error: could not write '%s'\n", output_path);
+    status = -1;
+  }
+
+  assembler_free(&as);
+  return status;
+}
+
+ProgramImage* program_image_open(const char* path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return NULL;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t)info.st_size < PROGRAM_HEADER_SIZE) {
+    close(fd);
+    return NULL;
+  }
+
+  size_t size = (size_t)info.st_size;
+  void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);  // The mapping stays valid
+  if (map == MAP_FAILED) return NULL;
+
+  const unsigned char* bytes = (const unsigned char*)map;
+  uint64_t length = get_u64(bytes + 16);
+  if (memcmp(bytes, PROGRAM_MAGIC, 8) != 0 ||
+      get_u32(bytes + 8) != PROGRAM_VERSION || length == 0 ||
+      length > INT_MAX || length > size - PROGRAM_HEADER_SIZE) {
+    munmap(map, size);
+    return NULL;
+  }
+
+  // Decoded front to back exactly once
+  posix_madvise(map, size, POSIX_MADV_SEQUENTIAL);
+
+  ProgramImage* image = (ProgramImage*)malloc(sizeof(ProgramImage));
+  Instruction* code = (Instruction*)malloc(length * sizeof(Instruction));
+  if (image == NULL || code == NULL) {
+    free(image);
+    free(code);
+    munmap(map, size);
+    return NULL;
+  }
+
+  const unsigned char* p = bytes + PROGRAM_HEADER_SIZE;
+  const unsigned char* end = bytes + size;
+  for (uint64_t i = 0; i < length; i++) {
+    int64_t fields[4] = {0, 0, 0, 0};
+    int count = 1;
+    for (int j = 0; j < count; j++) {
+      uint64_t encoded;
+      size_t n = varint_decode(p, (size_t)(end - p), &encoded);
+      if (n == 0) {  // Truncated file
+        free(image);
+        free(code);
+        munmap(map, size);
+        return NULL;
+      }
+      p += n;
+      fields[j] = zigzag_decode(encoded);
+      if (j == 0) count = 1 + opcode_operands((int)fields[0]);
+    }
+    code[i] = (Instruction){(int)fields[0], (int)fields[1], (int)fields[2],
+                            (int)fields[3]};
+  }
+
+  image->map = bytes;
+  image->size = size;
+  image->code = code;
+  image->length = (int)length;
+  image->result_address = (int64_t)get_u64(bytes + 24) - 1;
+  image->data = p;
+
+  return image;
+}
+
+void program_image_close(ProgramImage* image) {
+  if (image == NULL) return;
+
+  free(image->code);
+  munmap((void*)image->map, image->size);
+  free(image);
+}
+
+void program_image_load_data(const ProgramImage* image, RAM* ram) {
+  if (image == NULL || ram == NULL) return;
+
+  const unsigned char* p = image->data;
+  const unsigned char* end = image->map + image->size;
+  int buffer[1024];
+
+  while (p < end) {
+    uint64_t address, count;
+    size_t n = varint_decode(p, (size_t)(end - p), &address);
+    if (n == 0) return;
+    p += n;
+    n = varint_decode(p, (size_t)(end - p), &count);
+    if (n == 0) return;
+    p += n;
+
+    // Copied in chunks so long runs need no large buffer
+    while (count > 0) {
+      size_t chunk = 0;
+      while (chunk < sizeof(buffer) / sizeof(buffer[0]) && chunk < count) {
+        uint64_t encoded;
+        n = varint_decode(p, (size_t)(end - p), &encoded);
+        if (n == 0) break;
+        p += n;
+        buffer[chunk++] = (int)zigzag_decode(encoded);
+      }
+      if (chunk == 0) return;
+
+      set_ram_words(ram, address, buffer, chunk);
+      address += chunk;
+      count -= chunk;
+    }
+  }
+}
+
+int program_image_data_overlaps(const ProgramImage* image, uint64_t begin,
+                                uint64_t end) {
+  if (image == NULL) return 0;
+
+  const unsigned char* p = image->data;
+  const unsigned char* limit = image->map + image->size;
+
+  while (p < limit) {
+    uint64_t address, count;
+    size_t n = varint_decode(p, (size_t)(limit - p), &address);
+    if (n == 0) return 0;
+    p += n;
+    n = varint_decode(p, (size_t)(limit - p), &count);
+    if (n == 0) return 0;
+    p += n;
+
+    if (count > 0 && address < end && begin < address + count) return 1;
+
+    // Skip the run's values
+    for (uint64_t i = 0; i < count; i++) {
+      uint64_t encoded;
+      n = varint_decode(p, (size_t)(limit - p), &encoded);
+      if (n == 0) return 0;
+      p += n;
+    }
+  }
+
+  return 0;
+}
@@ -1,38 +1,27 @@
 #include "include/block.h"
 #include <string.h>
 
-
-void block_init(Block* block) {
-  if (block == NULL) return;
-  for (int i = 0; i < WORDS_PER_BLOCK; i++) {
-    block->words[i] = 0;
+int block_shape_init(BlockShape* shape, int words) {
+  if (shape == NULL || words < 1 || words > BLOCK_MAX_WORDS ||
+      (words & (words - 1)) != 0) {
+    return -1;  // Not a power of two in range
   }
-}
 
-int block_get_word(const Block* block, int word_offset) {
-  if (block == NULL || word_offset < 0 || word_offset >= WORDS_PER_BLOCK) {
-    return 0;  // Return 0 on error
-  }
+  int shift = 0;
+  while ((1 << shift) < words) shift++;
 
-  return block->words[word_offset];
+  shape->words = words;
+  shape->shift = shift;
+  shape->mask = (uint64_t)words - 1;
+  return 0;
 }
 
-void block_set_word(Block* block, int word_offset, int value) {
-  if (block == NULL || word_offset < 0 || word_offset >= WORDS_PER_BLOCK) {
-    return;
-  }
-
-  block->words[word_offset] = value;
+void block_init(int* block, int words) {
+  if (block == NULL) return;
+  memset(block, 0, (size_t)words * sizeof(int));
 }
 
-void block_copy(Block* dest, const Block* src) {
+void block_copy(int* dest, const int* src, int words) {
   if (dest == NULL || src == NULL) return;
-  memcpy(dest->words, src->words, WORDS_PER_BLOCK * sizeof(int));
+  memcpy(dest, src, (size_t)words * sizeof(int));
 }
-
-/*
-  block_init: Zera todos os valores do bloco
-  block_get_word: Pega um valor específico (índice 0-3) do bloco
-  block_set_word: Define um valor específico no bloco
-  block_copy: Copia todos os 4 valores de um bloco para outro (útil quando movemos dados entre RAM e Cache)
-*/
\ No newline at end of file
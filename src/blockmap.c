@@ -0,0 +1,71 @@
+#include "include/blockmap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int blockmap_init(BlockMap* map, size_t entry_size, size_t capacity) {
+  if (map == NULL || entry_size < sizeof(uint64_t) || capacity == 0 ||
+      (capacity & (capacity - 1)) != 0) {
+    return -1;
+  }
+
+  map->entries = (unsigned char*)calloc(capacity, entry_size);
+  if (map->entries == NULL) return -1;
+
+  map->entry_size = entry_size;
+  map->capacity = capacity;
+  map->count = 0;
+  return 0;
+}
+
+void blockmap_free(BlockMap* map) {
+  if (map == NULL) return;
+
+  free(map->entries);
+  map->entries = NULL;
+  map->capacity = 0;
+  map->count = 0;
+}
+
+void* blockmap_find(const BlockMap* map, uint64_t key) {
+  void* entry = blockmap_slot(map, key);
+  return (*(const uint64_t*)entry != 0) ? entry : NULL;
+}
+
+static int blockmap_grow(BlockMap* map) {
+  BlockMap grown;
+  if (blockmap_init(&grown, map->entry_size, map->capacity * 2) != 0) {
+    return -1;
+  }
+
+  for (size_t i = 0; i < map->capacity; i++) {
+    const unsigned char* old = map->entries + i * map->entry_size;
+    uint64_t stored = *(const uint64_t*)old;
+    if (stored != 0) {
+      memcpy(blockmap_slot(&grown, stored - 1), old, map->entry_size);
+    }
+  }
+
+  grown.count = map->count;
+  free(map->entries);
+  *map = grown;
+  return 0;
+}
+
+void* blockmap_insert(BlockMap* map, uint64_t key, int* added) {
+  if (added != NULL) *added = 0;
+
+  void* entry = blockmap_slot(map, key);
+  if (*(const uint64_t*)entry != 0) return entry;
+
+  // Keep the table at most half full
+  if (2 * (map->count + 1) > map->capacity) {
+    if (blockmap_grow(map) != 0) return NULL;
+    entry = blockmap_slot(map, key);
+  }
+
+  *(uint64_t*)entry = key + 1;
+  map->count++;
+  if (added != NULL) *added = 1;
+  return entry;
+}
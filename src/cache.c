@@ -1,28 +1,95 @@
 #include "include/cache.h"
 #include <stdlib.h>
-#include <limits.h>
 
-Cache* cache_create(int num_lines, int access_time) {
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(CACHE_SCALAR_SEARCH)
+#define CACHE_AVX2 1
+#include <immintrin.h>
+#endif
+
+// Metadata arrays start on a host cache line (64 bytes)
+static void* cache_alloc_aligned(size_t count, size_t size) {
+  size_t bytes = (count * size + 63) / 64 * 64;
+  return aligned_alloc(64, bytes);
+}
+
+Cache* cache_create(int num_lines, int block_words, int access_time) {
+  // One set holding every line: fully associative
+  return cache_create_assoc(num_lines, num_lines, block_words, access_time);
+}
+
+Cache* cache_create_assoc(int num_lines, int associativity, int block_words,
+                          int access_time) {
+  if (num_lines <= 0 || block_words <= 0) return NULL;
+
+  // 0 (or anything above num_lines) means fully associative
+  if (associativity <= 0 || associativity > num_lines) {
+    associativity = num_lines;
+  }
+
+  // Every set must have the same number of ways
+  if (num_lines % associativity != 0) return NULL;
+
   Cache* cache = (Cache*)malloc(sizeof(Cache));
   if (cache == NULL) return NULL;
     
+  int num_sets = num_lines / associativity;
+
+  cache->classifier = NULL;
   cache->lines = (CacheLine*)malloc(num_lines * sizeof(CacheLine));
-  if (cache->lines == NULL) {
-    free(cache);
+  cache->tags = (uint64_t*)cache_alloc_aligned(num_lines, sizeof(uint64_t));
+  cache->recency_prev = (int*)cache_alloc_aligned(num_lines, sizeof(int));
+  cache->recency_next = (int*)cache_alloc_aligned(num_lines, sizeof(int));
+  cache->set_mru = (int*)malloc(num_sets * sizeof(int));
+  cache->set_lru = (int*)malloc(num_sets * sizeof(int));
+  cache->slab = (int*)malloc((size_t)num_lines * block_words * sizeof(int));
+  if (cache->lines == NULL || cache->tags == NULL ||
+      cache->recency_prev == NULL || cache->recency_next == NULL ||
+      cache->set_mru == NULL || cache->set_lru == NULL ||
+      cache->slab == NULL) {
+    cache_destroy(cache);
     return NULL;
   }
     
   cache->num_lines = num_lines;
+  cache->associativity = associativity;
+  cache->num_sets = num_sets;
+  cache->block_words = block_words;
   cache->access_time = access_time;
   cache->hits = 0;
   cache->misses = 0;
+  cache->writebacks = 0;
+
+  cache->simd = 0;
+#ifdef CACHE_AVX2
+  cache->simd = (associativity >= CACHE_SIMD_MIN_WAYS &&
+                 __builtin_cpu_supports("avx2"));
+#endif
   
   // Initialize all lines as invalid (empty)
   for (int i = 0; i < num_lines; i++) {
     cache->lines[i].valid = 0;        // Line is empty
-    cache->lines[i].tag = -1;         // No block assigned
-    cache->lines[i].lru_counter = 0;  // Never accessed
-    block_init(&cache->lines[i].data);
+    cache->lines[i].dirty = 0;        // Nothing to write back
+    cache->lines[i].tag = CACHE_NO_TAG;  // No block assigned
+    cache->tags[i] = CACHE_NO_TAG;
+    cache->lines[i].prefetched = 0;
+    cache->lines[i].ready_time = 0;
+    cache->lines[i].state = CACHE_INVALID;
+    cache->lines[i].data = &cache->slab[(size_t)i * block_words];
+    block_init(cache->lines[i].data, block_words);
+  }
+
+  // Chain each set's lines into its recency list (all invalid for now)
+  for (int set = 0; set < num_sets; set++) {
+    int first = set * associativity;
+    int last = first + associativity - 1;
+
+    for (int i = first; i <= last; i++) {
+      cache->recency_prev[i] = (i == first) ? -1 : i - 1;
+      cache->recency_next[i] = (i == last) ? -1 : i + 1;
+    }
+
+    cache->set_mru[set] = first;
+    cache->set_lru[set] = last;
   }
   
   return cache;
@@ -34,63 +101,213 @@ void cache_destroy(Cache* cache) {
   if (cache->lines != NULL) {
     free(cache->lines);
   }
+  free(cache->tags);
+  free(cache->recency_prev);
+  free(cache->recency_next);
+  free(cache->set_mru);
+  free(cache->set_lru);
+  free(cache->slab);
+  miss_classifier_destroy(cache->classifier);
 
   free(cache);
 }
 
-CacheLine* cache_search(Cache* cache, int block_address, int word_offset) {
+static int cache_set_index(const Cache* cache, uint64_t block_address) {
+  return (int)(block_address % (uint64_t)cache->num_sets);
+}
+
+// Unlink a line from its set's recency list
+static void cache_list_remove(Cache* cache, int set, int index) {
+  int prev = cache->recency_prev[index];
+  int next = cache->recency_next[index];
+
+  if (prev != -1) {
+    cache->recency_next[prev] = next;
+  } else {
+    cache->set_mru[set] = next;
+  }
+
+  if (next != -1) {
+    cache->recency_prev[next] = prev;
+  } else {
+    cache->set_lru[set] = prev;
+  }
+}
+
+// Link a line at the MRU end of its set's recency list
+static void cache_list_push_mru(Cache* cache, int set, int index) {
+  int old_mru = cache->set_mru[set];
+
+  cache->recency_prev[index] = -1;
+  cache->recency_next[index] = old_mru;
+  if (old_mru != -1) {
+    cache->recency_prev[old_mru] = index;
+  } else {
+    cache->set_lru[set] = index;
+  }
+  cache->set_mru[set] = index;
+}
+
+// Link a line at the LRU end of its set's recency list
+static void cache_list_push_lru(Cache* cache, int set, int index) {
+  int old_lru = cache->set_lru[set];
+
+  cache->recency_prev[index] = old_lru;
+  cache->recency_next[index] = -1;
+  if (old_lru != -1) {
+    cache->recency_next[old_lru] = index;
+  } else {
+    cache->set_mru[set] = index;
+  }
+  cache->set_lru[set] = index;
+}
+
+#ifdef CACHE_AVX2
+// Eight tags per round, four per compare
+__attribute__((target("avx2"))) static int cache_find_way_avx2(
+    const uint64_t* tags, int ways, uint64_t block_address) {
+  __m256i wanted = _mm256_set1_epi64x((long long)block_address);
+
+  int way = 0;
+  for (; way + 8 <= ways; way += 8) {
+    __m256i low = _mm256_loadu_si256((const __m256i*)&tags[way]);
+    __m256i high = _mm256_loadu_si256((const __m256i*)&tags[way + 4]);
+    int low_mask =
+        _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(low, wanted)));
+    int high_mask = _mm256_movemask_pd(
+        _mm256_castsi256_pd(_mm256_cmpeq_epi64(high, wanted)));
+    int mask = low_mask | (high_mask << 4);
+    if (mask != 0) return way + __builtin_ctz((unsigned)mask);
+  }
+
+  for (; way < ways; way++) {
+    if (tags[way] == block_address) return way;
+  }
+  return -1;
+}
+#endif
+
+// Way of the set holding the block, -1 if none (empty lines never match)
+static int cache_find_way(const Cache* cache, uint64_t block_address) {
+  int set = cache_set_index(cache, block_address);
+  const uint64_t* tags = &cache->tags[set * cache->associativity];
+
+#ifdef CACHE_AVX2
+  if (cache->simd) {
+    return cache_find_way_avx2(tags, cache->associativity, block_address);
+  }
+#endif
+
+  for (int way = 0; way < cache->associativity; way++) {
+    if (tags[way] == block_address) return way;
+  }
+  return -1;
+}
+
+// Line holding the block, NULL if it is not cached
+static CacheLine* cache_find_line(Cache* cache, uint64_t block_address) {
+  int way = cache_find_way(cache, block_address);
+  if (way < 0) return NULL;
+
+  int set = cache_set_index(cache, block_address);
+  return &cache->lines[set * cache->associativity + way];
+}
+
+void cache_touch(Cache* cache, CacheLine* line) {
+  if (cache == NULL || line == NULL) return;
+
+  int index = (int)(line - cache->lines);
+  int set = index / cache->associativity;
+
+  if (cache->set_mru[set] != index) {
+    cache_list_remove(cache, set, index);
+    cache_list_push_mru(cache, set, index);
+  }
+}
+
+CacheLine* cache_probe(Cache* cache, uint64_t block_address) {
+  if (cache == NULL) return NULL;
+
+  return cache_find_line(cache, block_address);
+}
+
+CacheLine* cache_search(Cache* cache, uint64_t block_address, int word_offset) {
   if (cache == NULL) return NULL;
   
-  for (int i = 0; i < cache->num_lines; i++) {
-    CacheLine* line = &cache->lines[i];
-    if (line->valid && line->tag == block_address) {
-      cache->hits++;
-      return line;
-    }
+  // Only the tags of the block's set are read
+  CacheLine* line = cache_find_line(cache, block_address);
+  if (line != NULL) {
+    cache->hits++;
+    miss_classifier_record(cache->classifier, block_address, 1);
+    return line;
   }
   
   // CACHE MISS 😞
   cache->misses++;
+  miss_classifier_record(cache->classifier, block_address, 0);
   return NULL;
 }
 
-static int cache_find_lru_line(Cache* cache) {
-  int lru_index = 0;
-  int min_lru = INT_MAX;
-  
-  // First, try to find an empty line
-  for (int i = 0; i < cache->num_lines; i++) {
-    if (!cache->lines[i].valid) {
-      return i;  // Found empty line, use it! 
-    }
-  }
-  
-  // No empty lines, find least recently used (LRU)
-  for (int i = 0; i < cache->num_lines; i++) {
-    if (cache->lines[i].lru_counter < min_lru) {
-      min_lru = cache->lines[i].lru_counter;
-      lru_index = i;
-    }
-  }
-  
-  return lru_index;
+static CacheLine* cache_find_lru_line(Cache* cache, uint64_t block_address) {
+  // Every touch moves a line to the MRU end and lines start out at the LRU
+  // end while invalid, so the tail is either an empty line or the LRU one
+  int set = cache_set_index(cache, block_address);
+  return &cache->lines[cache->set_lru[set]];
 }
 
-void cache_load(Cache* cache, int block_address, const Block* block, int current_time) {
-  if (cache == NULL || block == NULL) return;
+CacheLine* cache_load(Cache* cache, uint64_t block_address, const int* block,
+                      CacheLine* evicted) {
+  if (evicted != NULL) evicted->valid = 0;
+  if (cache == NULL || block == NULL) return NULL;
   
-  // Find which line to replace
-  int line_index = cache_find_lru_line(cache);
-  CacheLine* line = &cache->lines[line_index];
+  // Find which line of the block's set to replace
+  CacheLine* line = cache_find_lru_line(cache, block_address);
+
+  // Hand the old contents back so the caller can write them back if dirty
+  if (line->valid && evicted != NULL) {
+    int* buffer = evicted->data;
+    *evicted = *line;
+    evicted->data = buffer;
+    block_copy(buffer, line->data, cache->block_words);
+  }
+  if (line->valid && line->dirty) {
+    cache->writebacks++;
+  }
   
   // Load the block into the line
   line->valid = 1;                     // Mark as valid
+  line->dirty = 0;                     // Same as the level below
+  line->prefetched = 0;                // Demand fill (the UCM marks prefetches)
+  line->ready_time = 0;
   line->tag = block_address;           // Set which block this is
-  block_copy(&line->data, block);      // Copy the data
-  line->lru_counter = current_time;    // Update access time
+  cache->tags[line - cache->lines] = block_address;
+  block_copy(line->data, block, cache->block_words);  // Copy the data
+  cache_touch(cache, line);  // Now the MRU line of its set
+
+  return line;
 }
 
-void cache_write(Cache* cache, int block_address, int word_offset, int value, int current_time) {
+void cache_invalidate(Cache* cache, CacheLine* line) {
+  if (cache == NULL || line == NULL) return;
+
+  int index = (int)(line - cache->lines);
+  int set = index / cache->associativity;
+
+  line->valid = 0;
+  line->dirty = 0;
+  line->prefetched = 0;
+  line->state = CACHE_INVALID;
+  line->tag = CACHE_NO_TAG;
+  cache->tags[index] = CACHE_NO_TAG;
+
+  // Empty lines wait at the LRU end, so the next load of the set takes it
+  if (cache->set_lru[set] != index) {
+    cache_list_remove(cache, set, index);
+    cache_list_push_lru(cache, set, index);
+  }
+}
+
+void cache_write(Cache* cache, uint64_t block_address, int word_offset, int value) {
   if (cache == NULL) return;
   
   // Try to find the block in cache
@@ -98,8 +315,8 @@ void cache_write(Cache* cache, int block_address, int word_offset, int value, in
   
   if (line != NULL) {
     // Block is in cache, update it
-    block_set_word(&line->data, word_offset, value);
-    line->lru_counter = current_time;  // Update LRU
+    line->data[word_offset] = value;
+    cache_touch(cache, line);  // Update LRU
   }
   // Note: If block not in cache, UCM will handle loading it first
 }
@@ -109,4 +326,14 @@ void cache_reset_stats(Cache* cache) {
   
   cache->hits = 0;
   cache->misses = 0;
+  cache->writebacks = 0;
+  miss_classifier_reset_stats(cache->classifier);
+}
+
+int cache_classify_misses(Cache* cache) {
+  if (cache == NULL) return -1;
+  if (cache->classifier != NULL) return 0;
+
+  cache->classifier = miss_classifier_create(cache->num_lines);
+  return cache->classifier != NULL ? 0 : -1;
 }
\ No newline at end of file
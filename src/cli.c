@@ -0,0 +1,558 @@
+#include "include/cli.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/program.h"
+#include "include/smp.h"
+
+#define CLI_LINE_SIZE 256
+
+// Parse "a,b,c" into out[]; returns how many values were read, -1 on error
+int cli_parse_int_list(const char* value, int* out, int max) {
+  int count = 0;
+  const char* p = value;
+
+  while (*p != '\0') {
+    char* end;
+    long number = strtol(p, &end, 10);
+    if (end == p || count == max) return -1;
+
+    out[count++] = (int)number;
+
+    while (*end == ' ') end++;
+    if (*end == ',') {
+      end++;
+    } else if (*end != '\0') {
+      return -1;
+    }
+    p = end;
+  }
+
+  return count;
+}
+
+static int parse_int(const char* value, int* out) {
+  char* end;
+  long number = strtol(value, &end, 10);
+  if (end == value || *end != '\0') return -1;
+
+  *out = (int)number;
+  return 0;
+}
+
+// An access time: an int of 0 cycles or more
+static int parse_cycles(const char* value, int* out) {
+  int cycles;
+  if (parse_int(value, &cycles) != 0 || cycles < 0) return -1;
+
+  *out = cycles;
+  return 0;
+}
+
+int cli_set_option(UCMConfig* config, const char* key, const char* value) {
+  if (config == NULL || key == NULL || value == NULL) return -1;
+
+  if (strcmp(key, "levels") == 0) {
+    int levels;
+    if (parse_int(value, &levels) != 0 || levels < 1 ||
+        levels > UCM_MAX_LEVELS) {
+      return -1;
+    }
+    config->num_levels = levels;
+    return 0;
+  }
+
+  if (strcmp(key, "lines") == 0) {
+    int count = cli_parse_int_list(value, config->lines, UCM_MAX_LEVELS);
+    if (count < 1) return -1;
+    config->num_levels = count;  // One size per level
+    return 0;
+  }
+
+  if (strcmp(key, "assoc") == 0) {
+    return cli_parse_int_list(value, config->associativity, UCM_MAX_LEVELS) < 1
+               ? -1
+               : 0;
+  }
+
+  if (strcmp(key, "latency") == 0) {
+    int latency[UCM_MAX_LEVELS];
+    int count = cli_parse_int_list(value, latency, UCM_MAX_LEVELS);
+    if (count < 1) return -1;
+    for (int i = 0; i < count; i++) {
+      if (latency[i] < 0) return -1;
+    }
+    memcpy(config->latency, latency, (size_t)count * sizeof(int));
+    return 0;
+  }
+
+  if (strcmp(key, "mshrs") == 0) {
+    int mshrs[UCM_MAX_LEVELS] = {0};
+    int count = cli_parse_int_list(value, mshrs, UCM_MAX_LEVELS);
+    if (count < 1) return -1;
+    for (int i = 0; i < UCM_MAX_LEVELS; i++) {
+      if (mshrs[i] < 0) return -1;
+      config->mshrs[i] = mshrs[i];
+    }
+    return 0;
+  }
+
+  if (strcmp(key, "block-words") == 0) {
+    BlockShape shape;
+    if (parse_int(value, &config->block_words) != 0 ||
+        block_shape_init(&shape, config->block_words) != 0) {
+      return -1;
+    }
+    return 0;
+  }
+
+  if (strcmp(key, "ram-latency") == 0) {
+    return parse_cycles(value, &config->ram_latency);
+  }
+
+  if (strcmp(key, "ram-words") == 0) {
+    char* end;
+    unsigned long long words = strtoull(value, &end, 10);
+    if (end == value || *end != '\0' || words == 0 || words > RAM_MAX_WORDS) {
+      return -1;
+    }
+
+    config->ram_words = (uint64_t)words;
+    return 0;
+  }
+
+  if (strcmp(key, "ram-frames") == 0) {
+    return (parse_int(value, &config->ram_frames) != 0 ||
+            config->ram_frames < 0)
+               ? -1
+               : 0;
+  }
+
+  if (strcmp(key, "page-words") == 0) {
+    return (parse_int(value, &config->page_words) != 0 ||
+            config->page_words < 1)
+               ? -1
+               : 0;
+  }
+
+  if (strcmp(key, "page-policy") == 0) {
+    if (strcmp(value, "lru") == 0) {
+      config->page_policy = RAM_PAGE_LRU;
+    } else if (strcmp(value, "fifo") == 0) {
+      config->page_policy = RAM_PAGE_FIFO;
+    } else if (strcmp(value, "clock") == 0) {
+      config->page_policy = RAM_PAGE_CLOCK;
+    } else {
+      return -1;
+    }
+    return 0;
+  }
+
+  if (strcmp(key, "disk-latency") == 0) {
+    return parse_cycles(value, &config->disk_latency);
+  }
+
+  if (strcmp(key, "write-policy") == 0) {
+    if (strcmp(value, "write-through") == 0) {
+      config->write_policy = UCM_WRITE_THROUGH;
+    } else if (strcmp(value, "write-back") == 0) {
+      config->write_policy = UCM_WRITE_BACK;
+    } else {
+      return -1;
+    }
+    return 0;
+  }
+
+  if (strcmp(key, "allocate-policy") == 0) {
+    if (strcmp(value, "write-allocate") == 0) {
+      config->allocate_policy = UCM_WRITE_ALLOCATE;
+    } else if (strcmp(value, "no-write-allocate") == 0) {
+      config->allocate_policy = UCM_NO_WRITE_ALLOCATE;
+    } else {
+      return -1;
+    }
+    return 0;
+  }
+
+  if (strcmp(key, "inclusion") == 0) {
+    if (strcmp(value, "nine") == 0) {
+      config->inclusion = UCM_NINE;
+    } else if (strcmp(value, "inclusive") == 0) {
+      config->inclusion = UCM_INCLUSIVE;
+    } else if (strcmp(value, "exclusive") == 0) {
+      config->inclusion = UCM_EXCLUSIVE;
+    } else {
+      return -1;
+    }
+    return 0;
+  }
+
+  if (strcmp(key, "fetch") == 0) {
+    if (strcmp(value, "on") == 0) {
+      config->fetch = 1;
+    } else if (strcmp(value, "off") == 0) {
+      config->fetch = 0;
+    } else {
+      return -1;
+    }
+    return 0;
+  }
+
+  if (strcmp(key, "l1i-lines") == 0) {
+    return (parse_int(value, &config->l1i_lines) != 0 ||
+            config->l1i_lines < 0)
+               ? -1
+               : 0;
+  }
+
+  if (strcmp(key, "l1i-assoc") == 0) {
+    return parse_int(value, &config->l1i_associativity);
+  }
+
+  if (strcmp(key, "l1i-latency") == 0) {
+    return parse_cycles(value, &config->l1i_latency);
+  }
+
+  if (strcmp(key, "code-base") == 0) {
+    char* end;
+    unsigned long long base = strtoull(value, &end, 10);
+    if (end == value || *end != '\0') return -1;
+
+    config->code_base = (uint64_t)base;
+    return 0;
+  }
+
+  if (strcmp(key, "victim-lines") == 0) {
+    return (parse_int(value, &config->victim_lines) != 0 ||
+            config->victim_lines < 0)
+               ? -1
+               : 0;
+  }
+
+  if (strcmp(key, "victim-latency") == 0) {
+    return parse_cycles(value, &config->victim_latency);
+  }
+
+  if (strcmp(key, "prefetch") == 0) {
+    if (strcmp(value, "none") == 0) {
+      config->prefetch = PREFETCH_NONE;
+    } else if (strcmp(value, "next-line") == 0) {
+      config->prefetch = PREFETCH_NEXT_LINE;
+    } else if (strcmp(value, "stride") == 0) {
+      config->prefetch = PREFETCH_STRIDE;
+    } else {
+      return -1;
+    }
+    return 0;
+  }
+
+  if (strcmp(key, "prefetch-degree") == 0) {
+    return (parse_int(value, &config->prefetch_degree) != 0 ||
+            config->prefetch_degree < 1 ||
+            config->prefetch_degree > PREFETCH_MAX_DEGREE)
+               ? -1
+               : 0;
+  }
+
+  if (strcmp(key, "prefetch-level") == 0) {
+    return (parse_int(value, &config->prefetch_level) != 0 ||
+            config->prefetch_level < 1 ||
+            config->prefetch_level > UCM_MAX_LEVELS)
+               ? -1
+               : 0;
+  }
+
+  if (strcmp(key, "classify-misses") == 0) {
+    if (strcmp(value, "on") == 0) {
+      config->classify_misses = 1;
+    } else if (strcmp(value, "off") == 0) {
+      config->classify_misses = 0;
+    } else {
+      return -1;
+    }
+    return 0;
+  }
+
+  return -1;  // Unknown key
+}
+
+// Trim spaces and the line break at both ends, in place
+static char* trim(char* text) {
+  while (*text == ' ' || *text == '\t') text++;
+
+  char* end = text + strlen(text);
+  while (end > text && (end[-1] == ' ' || end[-1] == '\t' ||
+                        end[-1] == '\n' || end[-1] == '\r')) {
+    end--;
+  }
+  *end = '\0';
+
+  return text;
+}
+
+int cli_load_config_file(const char* path, UCMConfig* config) {
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    fprintf(stderr, "Error: could not open config file '%s'\n", path);
+    return -1;
+  }
+
+  char buffer[CLI_LINE_SIZE];
+  int line_number = 0;
+  int status = 0;
+
+  while (fgets(buffer, sizeof(buffer), file) != NULL) {
+    line_number++;
+
+    char* comment = strchr(buffer, '#');
+    if (comment != NULL) *comment = '\0';
+
+    char* line = trim(buffer);
+    if (*line == '\0') continue;
+
+    char* equals = strchr(line, '=');
+    if (equals == NULL) {
+      fprintf(stderr, "%s:%d: expected 'key = value'\n", path, line_number);
+      status = -1;
+      break;
+    }
+
+    *equals = '\0';
+    char* key = trim(line);
+    char* value = trim(equals + 1);
+
+    if (cli_set_option(config, key, value) != 0) {
+      fprintf(stderr, "%s:%d: invalid option '%s = %s'\n", path, line_number,
+              key, value);
+      status = -1;
+      break;
+    }
+  }
+
+  fclose(file);
+  return status;
+}
+
+void cli_print_usage(const char* exe) {
+  printf("Usage: %s [options]\n", exe);
+  printf("\n");
+  printf("Program:\n");
+  printf("  -p, --program NAME        Program to run (default matrix_mult)\n");
+  printf("  -a, --args A[,B]          Program arguments\n");
+  printf("      --program-file FILE   Run an assembled program (mapped)\n");
+  printf("      --assemble FILE       Assemble FILE into --output and exit\n");
+  printf("  -o, --output FILE         Where --assemble writes the program\n");
+  printf("\n");
+  printf("Memory hierarchy:\n");
+  printf("  -c, --config FILE         Read 'key = value' options from FILE\n");
+  printf("      --levels N            Number of cache levels (1-%d)\n",
+         UCM_MAX_LEVELS);
+  printf("      --lines A,B,C         Lines per level (also sets --levels)\n");
+  printf("      --assoc A,B,C         Ways per level (0 = fully associative)\n");
+  printf("      --latency A,B,C       Access time per level (cycles)\n");
+  printf("      --mshrs A,B,C         Outstanding misses per level (0 = blocking)\n");
+  printf("      --block-words N       Words per line, power of two (1-%d)\n",
+         BLOCK_MAX_WORDS);
+  printf("      --ram-latency N       RAM access time (cycles)\n");
+  printf("      --ram-words N         Address space in words (2^32; max 2^61)\n");
+  printf("      --ram-frames N        Pages that fit in RAM (0 = no disk)\n");
+  printf("      --page-words N        Words per page (multiple of the block)\n");
+  printf("      --page-policy P       lru | fifo | clock\n");
+  printf("      --disk-latency N      Time per page read or written (cycles)\n");
+  printf("      --write-policy P      write-through | write-back\n");
+  printf("      --allocate-policy P   write-allocate | no-write-allocate\n");
+  printf("      --inclusion P         nine | inclusive | exclusive\n");
+  printf("      --fetch on|off        Fetch instructions through the caches\n");
+  printf("      --l1i-lines N         Instruction L1 lines (0 = unified L1)\n");
+  printf("      --l1i-assoc N         Instruction L1 ways (0 = fully assoc.)\n");
+  printf("      --l1i-latency N       Instruction L1 access time (cycles)\n");
+  printf("      --code-base N         Word address of the code (reserved; no data)\n");
+  printf("      --victim-lines N      Victim cache after L1 (0 = none)\n");
+  printf("      --victim-latency N    Victim cache access time (cycles)\n");
+  printf("      --prefetch P          none | next-line | stride\n");
+  printf("      --prefetch-degree N   Blocks fetched per miss (1-%d)\n",
+         PREFETCH_MAX_DEGREE);
+  printf("      --prefetch-level N    Level prefetches go into (default 1)\n");
+  printf("      --classify-misses S   on | off (default): split misses into\n");
+  printf("                            the 3 Cs\n");
+  printf("\n");
+  printf("RAM images:\n");
+  printf("      --load-image FILE     Start from a saved RAM (mapped, lazy)\n");
+  printf("      --save-image FILE     Save the RAM at the end of the run\n");
+  printf("\n");
+  printf("Traces:\n");
+  printf("      --record FILE         Save every memory access of the run\n");
+  printf("      --replay FILE         Run a saved trace instead of a program\n");
+  printf("\n");
+  printf("Analysis:\n");
+  printf("      --stats F             Report as box (default), json or csv\n");
+  printf("      --stats-file FILE     Write the report to FILE, not stdout\n");
+  printf("      --mrc N               Miss-ratio curve for 1..N lines, one pass\n");
+  printf("      --histogram S         on | off: access latency percentiles\n");
+  printf("      --heatmap FILE        Accesses and L1 misses per block (CSV)\n");
+  printf("\n");
+  printf("Sweep (runs every hierarchy in parallel and prints a table):\n");
+  printf("      --sweep FILE          One hierarchy per line ('key=value ...')\n");
+  printf("      --grid-lines G        Lines per level, e.g. 8,16/32,64/128,256\n");
+  printf("      --grid-latency G      Latency per level, same format\n");
+  printf("      --grid-assoc G        Ways per level, same format\n");
+  printf("      --threads N           Worker threads (default: one per core)\n");
+  printf("\n");
+  printf("Multi-core (private levels per core, last level shared, MESI):\n");
+  printf("      --cores N             Run the program on N CPUs (1-%d)\n",
+         SMP_MAX_CORES);
+  printf("                            Host threads: --threads (default: one\n");
+  printf("                            per CPU; 1 = CPUs in turn, repeatable)\n");
+  printf("\n");
+  printf("Programs:\n");
+  program_print_list();
+}
+
+// Every level needs a size and a latency; say which one is missing
+static int cli_check_levels(const UCMConfig* config) {
+  int sized = 0;
+  while (sized < UCM_MAX_LEVELS && config->lines[sized] > 0) sized++;
+  int timed = 0;
+  while (timed < UCM_MAX_LEVELS && config->latency[timed] >= 0) timed++;
+
+  if (sized < config->num_levels) {
+    fprintf(stderr, "Error: --levels %d but --lines only gives %d\n",
+            config->num_levels, sized);
+    return -1;
+  }
+  if (timed < config->num_levels) {
+    fprintf(stderr, "Error: --lines gives %d levels but --latency only %d\n",
+            config->num_levels, timed);
+    return -1;
+  }
+  return 0;
+}
+
+int cli_parse(int argc, char** argv, CliOptions* options) {
+  ucm_config_default(&options->config);
+  options->program = "matrix_mult";
+  options->num_args = 0;
+  options->args[0] = 0;
+  options->args[1] = 0;
+  options->help = 0;
+  options->sweep_file = NULL;
+  options->grid_lines = NULL;
+  options->grid_latency = NULL;
+  options->grid_assoc = NULL;
+  options->threads = 0;
+  options->record_path = NULL;
+  options->replay_path = NULL;
+  options->save_image = NULL;
+  options->program_file = NULL;
+  options->assemble = NULL;
+  options->output = NULL;
+  options->mrc_lines = 0;
+  options->histogram = 0;
+  options->heatmap_path = NULL;
+  options->stats_format = STATS_BOX;
+  options->stats_file = NULL;
+  options->cores = 1;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+
+    if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+      options->help = 1;
+      continue;
+    }
+
+    // Every other option takes a value
+    if (i + 1 >= argc) {
+      fprintf(stderr, "Error: missing value for '%s'\n", arg);
+      return -1;
+    }
+    const char* value = argv[++i];
+
+    if (strcmp(arg, "-p") == 0 || strcmp(arg, "--program") == 0) {
+      options->program = value;
+    } else if (strcmp(arg, "-a") == 0 || strcmp(arg, "--args") == 0) {
+      options->num_args = cli_parse_int_list(value, options->args, 2);
+      if (options->num_args < 1) {
+        fprintf(stderr, "Error: invalid program arguments '%s'\n", value);
+        return -1;
+      }
+    } else if (strcmp(arg, "-c") == 0 || strcmp(arg, "--config") == 0) {
+      if (cli_load_config_file(value, &options->config) != 0) return -1;
+    } else if (strcmp(arg, "--program-file") == 0) {
+      options->program_file = value;
+    } else if (strcmp(arg, "--assemble") == 0) {
+      options->assemble = value;
+    } else if (strcmp(arg, "-o") == 0 || strcmp(arg, "--output") == 0) {
+      options->output = value;
+    } else if (strcmp(arg, "--record") == 0) {
+      options->record_path = value;
+    } else if (strcmp(arg, "--replay") == 0) {
+      options->replay_path = value;
+    } else if (strcmp(arg, "--load-image") == 0) {
+      options->config.ram_image = value;
+    } else if (strcmp(arg, "--save-image") == 0) {
+      options->save_image = value;
+    } else if (strcmp(arg, "--mrc") == 0) {
+      if (parse_int(value, &options->mrc_lines) != 0 ||
+          options->mrc_lines < 1) {
+        fprintf(stderr, "Error: invalid curve size '%s'\n", value);
+        return -1;
+      }
+    } else if (strcmp(arg, "--histogram") == 0) {
+      if (strcmp(value, "on") == 0) {
+        options->histogram = 1;
+      } else if (strcmp(value, "off") == 0) {
+        options->histogram = 0;
+      } else {
+        fprintf(stderr, "Error: invalid histogram switch '%s'\n", value);
+        return -1;
+      }
+    } else if (strcmp(arg, "--heatmap") == 0) {
+      options->heatmap_path = value;
+    } else if (strcmp(arg, "--stats") == 0) {
+      if (stats_parse_format(value, &options->stats_format) != 0) {
+        fprintf(stderr, "Error: invalid stats format '%s'\n", value);
+        return -1;
+      }
+    } else if (strcmp(arg, "--stats-file") == 0) {
+      options->stats_file = value;
+    } else if (strcmp(arg, "--sweep") == 0) {
+      options->sweep_file = value;
+    } else if (strcmp(arg, "--grid-lines") == 0) {
+      options->grid_lines = value;
+    } else if (strcmp(arg, "--grid-latency") == 0) {
+      options->grid_latency = value;
+    } else if (strcmp(arg, "--grid-assoc") == 0) {
+      options->grid_assoc = value;
+    } else if (strcmp(arg, "--cores") == 0) {
+      if (parse_int(value, &options->cores) != 0 || options->cores < 1 ||
+          options->cores > SMP_MAX_CORES) {
+        fprintf(stderr, "Error: invalid core count '%s'\n", value);
+        return -1;
+      }
+    } else if (strcmp(arg, "--threads") == 0) {
+      if (parse_int(value, &options->threads) != 0 || options->threads < 0) {
+        fprintf(stderr, "Error: invalid thread count '%s'\n", value);
+        return -1;
+      }
+    } else if (strcmp(arg, "--latency") == 0) {
+      if (cli_set_option(&options->config, "latency", value) != 0) {
+        fprintf(stderr, "Error: invalid latency '%s' (cycles, 0 or more)\n",
+                value);
+        return -1;
+      }
+    } else if (strncmp(arg, "--", 2) == 0) {
+      if (cli_set_option(&options->config, arg + 2, value) != 0) {
+        fprintf(stderr, "Error: invalid option '%s %s'\n", arg, value);
+        return -1;
+      }
+    } else {
+      fprintf(stderr, "Error: unknown option '%s'\n", arg);
+      return -1;
+    }
+  }
+
+  return cli_check_levels(&options->config);
+}
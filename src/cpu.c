@@ -1,6 +1,8 @@
 #include "include/cpu.h"
 
+#include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "include/instruction.h"
 #include "include/opcodes.h"
@@ -15,6 +17,13 @@
   AC: Mantém os resultados das operações e funciona como registrador principal
 */
 
+// Messages (HALT, division by zero) are off while running sweeps
+static int cpu_verbose = 1;
+
+void cpu_set_verbose(int verbose) {
+  cpu_verbose = verbose;
+}
+
 // segue o principio de:  fetch-decode-execute
 
 void execute_cpu(Register *reg, UCM *ucm, Instruction *memory) {
@@ -24,13 +33,15 @@ void execute_cpu(Register *reg, UCM *ucm, Instruction *memory) {
 
   switch (reg->IR) {
   case HALT: 
-    puts("program endeed");
+    if (cpu_verbose) puts("program endeed");
     break;
 
   case ADD:
     // Read operands through UCM
+    ucm_overlap_begin(ucm);  // Neither operand depends on the other
     reg->R1 = ucm_access(ucm, inst.optr1, UCM_READ, 0);
     reg->R2 = ucm_access(ucm, inst.optr2, UCM_READ, 0);
+    ucm_overlap_end(ucm);
 
     reg->AC = reg->R1 + reg->R2;
 
@@ -40,8 +51,10 @@ void execute_cpu(Register *reg, UCM *ucm, Instruction *memory) {
 
   case SUB:
     // Read operands through UCM
+    ucm_overlap_begin(ucm);  // Neither operand depends on the other
     reg->R1 = ucm_access(ucm, inst.optr1, UCM_READ, 0);
     reg->R2 = ucm_access(ucm, inst.optr2, UCM_READ, 0);
+    ucm_overlap_end(ucm);
 
     reg->AC = reg->R1 - reg->R2;
 
@@ -51,8 +64,10 @@ void execute_cpu(Register *reg, UCM *ucm, Instruction *memory) {
 
   case MUL:
     // Read operands through UCM
+    ucm_overlap_begin(ucm);  // Neither operand depends on the other
     reg->R1 = ucm_access(ucm, inst.optr1, UCM_READ, 0);
     reg->R2 = ucm_access(ucm, inst.optr2, UCM_READ, 0);
+    ucm_overlap_end(ucm);
 
     reg->AC = reg->R1 * reg->R2;
 
@@ -62,13 +77,15 @@ void execute_cpu(Register *reg, UCM *ucm, Instruction *memory) {
 
   case DIV:
     // Read operands through UCM
+    ucm_overlap_begin(ucm);  // Neither operand depends on the other
     reg->R1 = ucm_access(ucm, inst.optr1, UCM_READ, 0);
     reg->R2 = ucm_access(ucm, inst.optr2, UCM_READ, 0);
+    ucm_overlap_end(ucm);
 
     if (reg->R2 == 0) {
-      puts("Error: couldn't divide by zero");
+      if (cpu_verbose) puts("Error: couldn't divide by zero");
       reg->AC = 0;
-      return;
+      break;  // Nothing is stored; go on with the next instruction
     }
 
     reg->AC = reg->R1 / reg->R2;
@@ -169,4 +186,345 @@ void execute_cpu(Register *reg, UCM *ucm, Instruction *memory) {
 
   // increment PC
   reg->PC++;
-}
\ No newline at end of file
+}
+
+// Instructions after predecoding: register choices are folded into the
+// operation, so each handler does one thing with no decisions left
+typedef enum {
+  CPU_OP_END,       // Past the last instruction
+  CPU_OP_HALT,
+  CPU_OP_NOP,       // Unknown opcode or register: only sets IR
+  CPU_OP_ADD,
+  CPU_OP_SUB,
+  CPU_OP_MUL,
+  CPU_OP_DIV,
+  CPU_OP_STORE_R1,  // COPY_REG_RAM / OBTAIN_REG
+  CPU_OP_STORE_R2,
+  CPU_OP_LOAD_R1,   // COPY_RAM_REG
+  CPU_OP_LOAD_R2,
+  CPU_OP_SET_R1,    // COPY_EXT_REG
+  CPU_OP_SET_R2,
+  CPU_OP_JUMP,
+  CPU_OP_JZ,
+  CPU_OP_JNZ,
+  CPU_OP_JGT,
+  CPU_OP_JLT,
+  CPU_OP_COUNT
+} CpuOpKind;
+
+typedef struct CpuOp {
+  const void* handler;  // Label of the handler (threaded dispatch)
+  int kind;
+  int opcode;           // For IR
+  int a, b, c;
+} CpuOp;
+
+static int cpu_register_op(int which_reg, int op_r1, int op_r2) {
+  if (which_reg == 1) return op_r1;
+  if (which_reg == 2) return op_r2;
+  return CPU_OP_NOP;
+}
+
+static int cpu_decode_kind(const Instruction* inst) {
+  switch (inst->opcode) {
+    case HALT: return CPU_OP_HALT;
+    case ADD: return CPU_OP_ADD;
+    case SUB: return CPU_OP_SUB;
+    case MUL: return CPU_OP_MUL;
+    case DIV: return CPU_OP_DIV;
+    case COPY_REG_RAM:
+    case OBTAIN_REG:
+      return cpu_register_op(inst->optr1, CPU_OP_STORE_R1, CPU_OP_STORE_R2);
+    case COPY_RAM_REG:
+      return cpu_register_op(inst->optr1, CPU_OP_LOAD_R1, CPU_OP_LOAD_R2);
+    case COPY_EXT_REG:
+      return cpu_register_op(inst->optr1, CPU_OP_SET_R1, CPU_OP_SET_R2);
+    case JUMP: return CPU_OP_JUMP;
+    case JZ: return CPU_OP_JZ;
+    case JNZ: return CPU_OP_JNZ;
+    case JGT: return CPU_OP_JGT;
+    case JLT: return CPU_OP_JLT;
+    default: return CPU_OP_NOP;
+  }
+}
+
+// One op per instruction plus an END sentinel, so running off the end
+// needs no bounds check
+static CpuOp* cpu_decode(const Instruction* program, int length) {
+  CpuOp* code = (CpuOp*)malloc(((size_t)length + 1) * sizeof(CpuOp));
+  if (code == NULL) return NULL;
+
+  for (int i = 0; i < length; i++) {
+    const Instruction* inst = &program[i];
+    CpuOp* op = &code[i];
+
+    op->kind = cpu_decode_kind(inst);
+    op->opcode = inst->opcode;
+    op->a = inst->optr1;
+    op->b = inst->optr2;
+    op->c = inst->optr3;
+
+    // Register moves keep only the address or value
+    if (op->kind >= CPU_OP_STORE_R1 && op->kind <= CPU_OP_SET_R2) {
+      op->a = inst->optr2;
+    }
+  }
+
+  code[length] = (CpuOp){NULL, CPU_OP_END, 0, 0, 0, 0};
+  return code;
+}
+
+int cpu_code_fits(const RAM* ram, uint64_t code_base, int length) {
+  uint64_t size = (uint64_t)length * CPU_INSTRUCTION_WORDS;
+  return size <= ram->num_words && code_base <= ram->num_words - size;
+}
+
+// Copy the program into the RAM at code_base for the UCM to fetch from;
+// -1 (nothing written) if the code region does not fit in the RAM
+static int cpu_place_program(UCM* ucm, const Instruction* program,
+                             int length) {
+  if (!cpu_code_fits(ucm->ram, ucm->code_base, length)) return -1;
+
+  for (int i = 0; i < length; i++) {
+    int words[CPU_INSTRUCTION_WORDS] = {program[i].opcode, program[i].optr1,
+                                        program[i].optr2, program[i].optr3};
+    set_ram_words(ucm->ram,
+                  ucm->code_base + (uint64_t)i * CPU_INSTRUCTION_WORDS,
+                  words, CPU_INSTRUCTION_WORDS);
+  }
+  return 0;
+}
+
+// One fetch per cache block the instruction spans
+static void cpu_fetch(UCM* ucm, uint64_t address) {
+  uint64_t last = address + CPU_INSTRUCTION_WORDS - 1;
+  if (last >= ucm->ram->num_words) last = ucm->ram->num_words - 1;
+
+  uint64_t block = word_to_block(&ucm->block, address);
+  uint64_t last_block = word_to_block(&ucm->block, last);
+
+  ucm_access(ucm, address, UCM_FETCH, 0);
+  while (block < last_block) {
+    block++;
+    ucm_access(ucm, block_to_word(&ucm->block, block), UCM_FETCH, 0);
+  }
+}
+
+#if defined(__GNUC__) && !defined(CPU_SWITCH_DISPATCH)
+#define CPU_THREADED 1
+#endif
+
+#ifdef CPU_THREADED
+// Each handler jumps straight to the next one (computed goto)
+#define CPU_HANDLER(kind) handler_##kind:
+#define CPU_DISPATCH()                                                   \
+  do {                                                                   \
+    if (executed == limit) goto stop;                                    \
+    executed++;                                                          \
+    op = &code[pc];                                                      \
+    if (fetching && pc < length) {                                       \
+      cpu_fetch(ucm, code_base + (uint64_t)pc * CPU_INSTRUCTION_WORDS);  \
+    }                                                                    \
+    goto *op->handler;                                                   \
+  } while (0)
+#else
+#define CPU_HANDLER(kind) case kind:
+#define CPU_DISPATCH() goto dispatch
+#endif
+
+#define CPU_NEXT() \
+  do {             \
+    pc++;          \
+    CPU_DISPATCH(); \
+  } while (0)
+
+// Taken jumps leave the program when the target is outside it
+#define CPU_JUMP_TO(target)                                \
+  do {                                                     \
+    pc = (target);                                         \
+    if (pc < 0 || pc >= length) goto stop;                 \
+    CPU_DISPATCH();                                        \
+  } while (0)
+
+long cpu_run(Register* reg, UCM* ucm, const Instruction* program, int length,
+             long budget) {
+  if (reg == NULL || program == NULL || length <= 0) return 0;
+
+  // Instruction fetch through the caches, when the hierarchy models it
+  int fetching = (ucm != NULL && ucm->fetch);
+  if (fetching && cpu_place_program(ucm, program, length) != 0) return -1;
+  uint64_t code_base = fetching ? ucm->code_base : 0;
+
+  CpuOp* code = cpu_decode(program, length);
+  if (code == NULL) return 0;
+
+#ifdef CPU_THREADED
+  static const void* const handlers[CPU_OP_COUNT] = {
+      &&handler_CPU_OP_END,      &&handler_CPU_OP_HALT,
+      &&handler_CPU_OP_NOP,      &&handler_CPU_OP_ADD,
+      &&handler_CPU_OP_SUB,      &&handler_CPU_OP_MUL,
+      &&handler_CPU_OP_DIV,      &&handler_CPU_OP_STORE_R1,
+      &&handler_CPU_OP_STORE_R2, &&handler_CPU_OP_LOAD_R1,
+      &&handler_CPU_OP_LOAD_R2,  &&handler_CPU_OP_SET_R1,
+      &&handler_CPU_OP_SET_R2,   &&handler_CPU_OP_JUMP,
+      &&handler_CPU_OP_JZ,       &&handler_CPU_OP_JNZ,
+      &&handler_CPU_OP_JGT,      &&handler_CPU_OP_JLT,
+  };
+  for (int i = 0; i <= length; i++) code[i].handler = handlers[code[i].kind];
+#endif
+
+  // Registers live in locals while running
+  int pc = reg->PC;
+  int ac = reg->AC;
+  int ir = reg->IR;
+  int r1 = reg->R1;
+  int r2 = reg->R2;
+
+  long executed = 0;
+  long limit = (budget > 0) ? budget : LONG_MAX;
+  const CpuOp* op = NULL;
+
+  if (pc < 0 || pc >= length) goto stop;
+
+#ifdef CPU_THREADED
+  CPU_DISPATCH();
+#else
+dispatch:
+  if (executed == limit) goto stop;
+  executed++;
+  op = &code[pc];
+  if (fetching && pc < length) {
+    cpu_fetch(ucm, code_base + (uint64_t)pc * CPU_INSTRUCTION_WORDS);
+  }
+  switch (op->kind) {
+#endif
+
+  CPU_HANDLER(CPU_OP_END)
+    executed--;  // Not an instruction
+    goto stop;
+
+  CPU_HANDLER(CPU_OP_HALT)
+    ir = HALT;
+    if (cpu_verbose) puts("program endeed");
+    pc++;
+    goto stop;
+
+  CPU_HANDLER(CPU_OP_NOP)
+    ir = op->opcode;
+    CPU_NEXT();
+
+  CPU_HANDLER(CPU_OP_ADD)
+    ir = op->opcode;
+    ucm_overlap_begin(ucm);
+    r1 = ucm_access(ucm, op->a, UCM_READ, 0);
+    r2 = ucm_access(ucm, op->b, UCM_READ, 0);
+    ucm_overlap_end(ucm);
+    ac = r1 + r2;
+    ucm_access(ucm, op->c, UCM_WRITE, ac);
+    CPU_NEXT();
+
+  CPU_HANDLER(CPU_OP_SUB)
+    ir = op->opcode;
+    ucm_overlap_begin(ucm);
+    r1 = ucm_access(ucm, op->a, UCM_READ, 0);
+    r2 = ucm_access(ucm, op->b, UCM_READ, 0);
+    ucm_overlap_end(ucm);
+    ac = r1 - r2;
+    ucm_access(ucm, op->c, UCM_WRITE, ac);
+    CPU_NEXT();
+
+  CPU_HANDLER(CPU_OP_MUL)
+    ir = op->opcode;
+    ucm_overlap_begin(ucm);
+    r1 = ucm_access(ucm, op->a, UCM_READ, 0);
+    r2 = ucm_access(ucm, op->b, UCM_READ, 0);
+    ucm_overlap_end(ucm);
+    ac = r1 * r2;
+    ucm_access(ucm, op->c, UCM_WRITE, ac);
+    CPU_NEXT();
+
+  CPU_HANDLER(CPU_OP_DIV)
+    ir = op->opcode;
+    ucm_overlap_begin(ucm);
+    r1 = ucm_access(ucm, op->a, UCM_READ, 0);
+    r2 = ucm_access(ucm, op->b, UCM_READ, 0);
+    ucm_overlap_end(ucm);
+    if (r2 == 0) {
+      if (cpu_verbose) puts("Error: couldn't divide by zero");
+      ac = 0;
+      CPU_NEXT();
+    }
+    ac = r1 / r2;
+    ucm_access(ucm, op->c, UCM_WRITE, ac);
+    CPU_NEXT();
+
+  CPU_HANDLER(CPU_OP_STORE_R1)
+    ir = op->opcode;
+    ucm_access(ucm, op->a, UCM_WRITE, r1);
+    CPU_NEXT();
+
+  CPU_HANDLER(CPU_OP_STORE_R2)
+    ir = op->opcode;
+    ucm_access(ucm, op->a, UCM_WRITE, r2);
+    CPU_NEXT();
+
+  CPU_HANDLER(CPU_OP_LOAD_R1)
+    ir = op->opcode;
+    r1 = ucm_access(ucm, op->a, UCM_READ, 0);
+    CPU_NEXT();
+
+  CPU_HANDLER(CPU_OP_LOAD_R2)
+    ir = op->opcode;
+    r2 = ucm_access(ucm, op->a, UCM_READ, 0);
+    CPU_NEXT();
+
+  CPU_HANDLER(CPU_OP_SET_R1)
+    ir = op->opcode;
+    r1 = op->a;
+    CPU_NEXT();
+
+  CPU_HANDLER(CPU_OP_SET_R2)
+    ir = op->opcode;
+    r2 = op->a;
+    CPU_NEXT();
+
+  CPU_HANDLER(CPU_OP_JUMP)
+    ir = op->opcode;
+    CPU_JUMP_TO(op->a);
+
+  CPU_HANDLER(CPU_OP_JZ)
+    ir = op->opcode;
+    if (ac == 0) CPU_JUMP_TO(op->a);
+    CPU_NEXT();
+
+  CPU_HANDLER(CPU_OP_JNZ)
+    ir = op->opcode;
+    if (ac != 0) CPU_JUMP_TO(op->a);
+    CPU_NEXT();
+
+  CPU_HANDLER(CPU_OP_JGT)
+    ir = op->opcode;
+    if (ac > 0) CPU_JUMP_TO(op->a);
+    CPU_NEXT();
+
+  CPU_HANDLER(CPU_OP_JLT)
+    ir = op->opcode;
+    if (ac < 0) CPU_JUMP_TO(op->a);
+    CPU_NEXT();
+
+#ifndef CPU_THREADED
+  default:
+    goto stop;
+  }
+#endif
+
+stop:
+  reg->PC = pc;
+  reg->AC = ac;
+  reg->IR = ir;
+  reg->R1 = r1;
+  reg->R2 = r2;
+
+  free(code);
+  return executed;
+}
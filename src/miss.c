@@ -0,0 +1,180 @@
+#include "include/miss.h"
+
+#include <stdlib.h>
+
+#define MISS_INITIAL_SEEN 1024
+
+MissClassifier* miss_classifier_create(int lines) {
+  if (lines < 1) return NULL;
+
+  MissClassifier* classifier =
+      (MissClassifier*)calloc(1, sizeof(MissClassifier));
+  if (classifier == NULL) return NULL;
+
+  classifier->index_capacity = 16;
+  while (classifier->index_capacity < 2 * (size_t)lines) {
+    classifier->index_capacity *= 2;
+  }
+
+  classifier->lines = lines;
+  int status =
+      blockmap_init(&classifier->seen, sizeof(uint64_t), MISS_INITIAL_SEEN);
+  classifier->shadow_block = (uint64_t*)malloc(lines * sizeof(uint64_t));
+  classifier->shadow_prev = (int*)malloc(lines * sizeof(int));
+  classifier->shadow_next = (int*)malloc(lines * sizeof(int));
+  classifier->shadow_index =
+      (int*)malloc(classifier->index_capacity * sizeof(int));
+  classifier->shadow_mru = -1;
+  classifier->shadow_lru = -1;
+
+  if (status != 0 || classifier->shadow_block == NULL ||
+      classifier->shadow_prev == NULL || classifier->shadow_next == NULL ||
+      classifier->shadow_index == NULL) {
+    miss_classifier_destroy(classifier);
+    return NULL;
+  }
+
+  for (size_t i = 0; i < classifier->index_capacity; i++) {
+    classifier->shadow_index[i] = -1;
+  }
+
+  return classifier;
+}
+
+void miss_classifier_destroy(MissClassifier* classifier) {
+  if (classifier == NULL) return;
+
+  blockmap_free(&classifier->seen);
+  free(classifier->shadow_block);
+  free(classifier->shadow_prev);
+  free(classifier->shadow_next);
+  free(classifier->shadow_index);
+  free(classifier);
+}
+
+// Marks the block as seen: 1 the first time, 0 after, -1 out of memory
+static int miss_first_touch(MissClassifier* classifier, uint64_t block) {
+  int added;
+  if (blockmap_insert(&classifier->seen, block, &added) == NULL) return -1;
+  return added;
+}
+
+// Index slot holding the shadow line of `block`, or the empty slot
+static size_t miss_index_slot(const MissClassifier* classifier,
+                              uint64_t block) {
+  size_t mask = classifier->index_capacity - 1;
+  size_t i = blockmap_hash(block) & mask;
+  while (classifier->shadow_index[i] != -1 &&
+         classifier->shadow_block[classifier->shadow_index[i]] != block) {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+// Remove a slot and shift the entries after it back (linear probing)
+static void miss_index_remove(MissClassifier* classifier, size_t slot) {
+  size_t mask = classifier->index_capacity - 1;
+  size_t hole = slot;
+  size_t i = (slot + 1) & mask;
+
+  while (classifier->shadow_index[i] != -1) {
+    int line = classifier->shadow_index[i];
+    size_t home = blockmap_hash(classifier->shadow_block[line]) & mask;
+
+    // Move it into the hole unless its home lies between the hole and it
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      classifier->shadow_index[hole] = line;
+      hole = i;
+    }
+    i = (i + 1) & mask;
+  }
+  classifier->shadow_index[hole] = -1;
+}
+
+static void miss_shadow_unlink(MissClassifier* classifier, int line) {
+  int prev = classifier->shadow_prev[line];
+  int next = classifier->shadow_next[line];
+
+  if (prev != -1) {
+    classifier->shadow_next[prev] = next;
+  } else {
+    classifier->shadow_mru = next;
+  }
+  if (next != -1) {
+    classifier->shadow_prev[next] = prev;
+  } else {
+    classifier->shadow_lru = prev;
+  }
+}
+
+static void miss_shadow_push_mru(MissClassifier* classifier, int line) {
+  classifier->shadow_prev[line] = -1;
+  classifier->shadow_next[line] = classifier->shadow_mru;
+  if (classifier->shadow_mru != -1) {
+    classifier->shadow_prev[classifier->shadow_mru] = line;
+  } else {
+    classifier->shadow_lru = line;
+  }
+  classifier->shadow_mru = line;
+}
+
+// Access the shadow cache; returns 1 on a hit
+static int miss_shadow_access(MissClassifier* classifier, uint64_t block) {
+  size_t slot = miss_index_slot(classifier, block);
+  int line = classifier->shadow_index[slot];
+
+  if (line != -1) {
+    if (classifier->shadow_mru != line) {
+      miss_shadow_unlink(classifier, line);
+      miss_shadow_push_mru(classifier, line);
+    }
+    return 1;
+  }
+
+  // Miss: take a free line, or the LRU one
+  if (classifier->used < classifier->lines) {
+    line = classifier->used++;
+  } else {
+    line = classifier->shadow_lru;
+    miss_index_remove(classifier,
+                      miss_index_slot(classifier,
+                                      classifier->shadow_block[line]));
+    miss_shadow_unlink(classifier, line);
+    slot = miss_index_slot(classifier, block);  // The removal moved slots
+  }
+
+  classifier->shadow_block[line] = block;
+  classifier->shadow_index[slot] = line;
+  miss_shadow_push_mru(classifier, line);
+  return 0;
+}
+
+void miss_classifier_record(MissClassifier* classifier, uint64_t block_address,
+                            int hit) {
+  if (classifier == NULL || classifier->failed) return;
+
+  int first = miss_first_touch(classifier, block_address);
+  if (first < 0) {
+    classifier->failed = 1;
+    return;
+  }
+
+  int shadow_hit = miss_shadow_access(classifier, block_address);
+  if (hit) return;
+
+  if (first) {
+    classifier->compulsory++;
+  } else if (!shadow_hit) {
+    classifier->capacity++;
+  } else {
+    classifier->conflict++;
+  }
+}
+
+void miss_classifier_reset_stats(MissClassifier* classifier) {
+  if (classifier == NULL) return;
+
+  classifier->compulsory = 0;
+  classifier->capacity = 0;
+  classifier->conflict = 0;
+}
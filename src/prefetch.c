@@ -0,0 +1,123 @@
+#include "include/prefetch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+Prefetcher* prefetcher_create(PrefetchPolicy policy, int degree) {
+  if (policy == PREFETCH_NONE) return NULL;
+  if (degree < 1 || degree > PREFETCH_MAX_DEGREE) return NULL;
+
+  Prefetcher* prefetcher = (Prefetcher*)calloc(1, sizeof(Prefetcher));
+  if (prefetcher == NULL) return NULL;
+
+  prefetcher->policy = policy;
+  prefetcher->degree = degree;
+
+  return prefetcher;
+}
+
+void prefetcher_destroy(Prefetcher* prefetcher) {
+  free(prefetcher);
+}
+
+static int prefetcher_seen(const Prefetcher* prefetcher,
+                           uint64_t block_address) {
+  for (int i = 0; i < prefetcher->history_count; i++) {
+    if (prefetcher->history[i] == block_address) return 1;
+  }
+  return 0;
+}
+
+// Smallest stride s with both b-s and b-2s among the recent triggers,
+// 0 if no stream through `block_address` repeated its stride yet
+static int64_t prefetcher_stride(const Prefetcher* prefetcher,
+                                 uint64_t block_address) {
+  int64_t best = 0;
+
+  for (int i = 0; i < prefetcher->history_count; i++) {
+    int64_t stride = (int64_t)(block_address - prefetcher->history[i]);
+    if (stride == 0 || stride > PREFETCH_WINDOW || stride < -PREFETCH_WINDOW) {
+      continue;
+    }
+    if (best != 0 && llabs(stride) >= llabs(best)) continue;
+
+    uint64_t before = prefetcher->history[i] - (uint64_t)stride;
+    if (prefetcher_seen(prefetcher, before)) best = stride;
+  }
+
+  return best;
+}
+
+int prefetcher_candidates(Prefetcher* prefetcher, uint64_t block_address,
+                          uint64_t* out) {
+  if (prefetcher == NULL) return 0;
+
+  if (prefetcher->policy == PREFETCH_NEXT_LINE) {
+    for (int i = 0; i < prefetcher->degree; i++) {
+      out[i] = block_address + (uint64_t)(i + 1);
+    }
+    return prefetcher->degree;
+  }
+
+  int64_t stride = prefetcher_stride(prefetcher, block_address);
+
+  prefetcher->history[prefetcher->history_next] = block_address;
+  prefetcher->history_next = (prefetcher->history_next + 1) % PREFETCH_HISTORY;
+  if (prefetcher->history_count < PREFETCH_HISTORY) {
+    prefetcher->history_count++;
+  }
+
+  int count = 0;
+  for (int i = 1; stride != 0 && i <= prefetcher->degree; i++) {
+    int64_t target = (int64_t)block_address + stride * i;
+    if (target < 0) break;
+    out[count++] = (uint64_t)target;
+  }
+  return count;
+}
+
+static uint64_t prefetcher_victim_key(int level, int levels,
+                                      uint64_t block_address) {
+  return block_address * (uint64_t)levels + (uint64_t)level + 1;
+}
+
+void prefetcher_record_victim(Prefetcher* prefetcher, int level, int levels,
+                              uint64_t block_address) {
+  if (prefetcher == NULL) return;
+
+  uint64_t key = prefetcher_victim_key(level, levels, block_address);
+  prefetcher->victims[key % PREFETCH_VICTIMS] = key;
+}
+
+int prefetcher_was_victim(Prefetcher* prefetcher, int level, int levels,
+                          uint64_t block_address) {
+  if (prefetcher == NULL) return 0;
+
+  uint64_t key = prefetcher_victim_key(level, levels, block_address);
+  uint64_t* slot = &prefetcher->victims[key % PREFETCH_VICTIMS];
+  if (*slot != key) return 0;
+
+  *slot = 0;  // Count each eviction once
+  return 1;
+}
+
+void prefetcher_reset_stats(Prefetcher* prefetcher) {
+  if (prefetcher == NULL) return;
+
+  prefetcher->issued = 0;
+  prefetcher->useful = 0;
+  prefetcher->late = 0;
+  prefetcher->polluting = 0;
+  memset(prefetcher->victims, 0, sizeof(prefetcher->victims));
+}
+
+const char* prefetcher_policy_name(PrefetchPolicy policy) {
+  switch (policy) {
+    case PREFETCH_NEXT_LINE:
+      return "next-line";
+    case PREFETCH_STRIDE:
+      return "stride";
+    default:
+      return "none";
+  }
+}
@@ -0,0 +1,195 @@
+#include "include/profile.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define PROFILE_INITIAL_BLOCKS 1024
+
+AccessProfile* profile_create(int heatmap) {
+  AccessProfile* profile = (AccessProfile*)calloc(1, sizeof(AccessProfile));
+  if (profile == NULL) return NULL;
+
+  if (heatmap && blockmap_init(&profile->blocks, sizeof(ProfileBlock),
+                                PROFILE_INITIAL_BLOCKS) != 0) {
+    free(profile);
+    return NULL;
+  }
+
+  return profile;
+}
+
+void profile_destroy(AccessProfile* profile) {
+  if (profile == NULL) return;
+
+  blockmap_free(&profile->blocks);
+  free(profile);
+}
+
+// 0 -> 0, 1 -> 1, 2..3 -> 2, 4..7 -> 3, ...
+static int profile_bucket(uint64_t latency) {
+  if (latency == 0) return 0;
+
+  int bucket = 64 - __builtin_clzll(latency);
+  return (bucket < PROFILE_BUCKETS) ? bucket : PROFILE_BUCKETS - 1;
+}
+
+void profile_record(AccessProfile* profile, uint64_t block_address,
+                    UCM_Operation operation, int source, uint64_t latency) {
+  if (profile == NULL) return;
+
+  ProfileKind kind = (operation == UCM_WRITE)   ? PROFILE_WRITE
+                     : (operation == UCM_FETCH) ? PROFILE_FETCH
+                                                : PROFILE_READ;
+  profile->histogram[kind][source][profile_bucket(latency)]++;
+  if (latency > profile->max_latency[kind][source]) {
+    profile->max_latency[kind][source] = latency;
+  }
+
+  if (profile->blocks.entries == NULL) return;
+
+  ProfileBlock* entry =
+      (ProfileBlock*)blockmap_insert(&profile->blocks, block_address, NULL);
+  if (entry == NULL) return;
+
+  entry->accesses++;
+  if (source != 0) entry->misses++;
+}
+
+static const char* profile_kind_name(int kind) {
+  switch (kind) {
+    case PROFILE_READ:
+      return "Read";
+    case PROFILE_WRITE:
+      return "Write";
+    default:
+      return "Fetch";
+  }
+}
+
+static void profile_source_name(int source, char* name, size_t size) {
+  if (source == UCM_SOURCE_VICTIM) {
+    snprintf(name, size, "Victim");
+  } else if (source == UCM_SOURCE_RAM) {
+    snprintf(name, size, "RAM");
+  } else {
+    snprintf(name, size, "L%d", source + 1);
+  }
+}
+
+// Largest latency in bucket b
+static uint64_t profile_bucket_limit(int bucket) {
+  return (bucket == 0) ? 0 : (1ULL << bucket) - 1;
+}
+
+// Upper limit of the bucket holding the given fraction of the accesses
+// (never above the largest latency seen)
+static uint64_t profile_percentile(const uint64_t* buckets, uint64_t count,
+                                   uint64_t max, double fraction) {
+  uint64_t wanted = (uint64_t)((double)count * fraction);
+  if (wanted == 0) wanted = 1;
+
+  uint64_t seen = 0;
+  int b = 0;
+  while (b < PROFILE_BUCKETS - 1 && seen + buckets[b] < wanted) {
+    seen += buckets[b++];
+  }
+  uint64_t limit = profile_bucket_limit(b);
+  return (limit < max) ? limit : max;
+}
+
+void profile_print_latency(const AccessProfile* profile, FILE* out) {
+  if (profile == NULL) return;
+
+  // Totals per kind and bucket, over every source
+  uint64_t totals[PROFILE_KINDS][PROFILE_BUCKETS];
+  memset(totals, 0, sizeof(totals));
+  int first = PROFILE_BUCKETS;
+  int last = -1;
+  for (int kind = 0; kind < PROFILE_KINDS; kind++) {
+    for (int source = 0; source < UCM_SOURCES; source++) {
+      for (int b = 0; b < PROFILE_BUCKETS; b++) {
+        uint64_t count = profile->histogram[kind][source][b];
+        totals[kind][b] += count;
+        if (count > 0 && b < first) first = b;
+        if (count > 0 && b > last) last = b;
+      }
+    }
+  }
+
+  fprintf(out, "\n=== ACCESS LATENCY (cycles, log2 buckets) ===\n");
+  fprintf(out, "        Latency |     Reads |    Writes |   Fetches\n");
+  fprintf(out, "----------------|-----------|-----------|----------\n");
+  for (int b = first; b <= last; b++) {
+    uint64_t low = (b == 0) ? 0 : 1ULL << (b - 1);
+    fprintf(out, "%7llu-%-7llu | %9llu | %9llu | %9llu\n",
+            (unsigned long long)low,
+            (unsigned long long)profile_bucket_limit(b),
+            (unsigned long long)totals[PROFILE_READ][b],
+            (unsigned long long)totals[PROFILE_WRITE][b],
+            (unsigned long long)totals[PROFILE_FETCH][b]);
+  }
+
+  fprintf(out, "\n  Kind | Served by |  Accesses |     p50 |     p90 |"
+               "     p99 |     Max\n");
+  fprintf(out, "-------|-----------|-----------|---------|---------|"
+               "---------|--------\n");
+  for (int kind = 0; kind < PROFILE_KINDS; kind++) {
+    for (int source = 0; source < UCM_SOURCES; source++) {
+      const uint64_t* buckets = profile->histogram[kind][source];
+      uint64_t count = 0;
+      for (int b = 0; b < PROFILE_BUCKETS; b++) count += buckets[b];
+      if (count == 0) continue;
+
+      uint64_t max = profile->max_latency[kind][source];
+      char name[16];
+      profile_source_name(source, name, sizeof(name));
+      uint64_t p50 = profile_percentile(buckets, count, max, 0.50);
+      uint64_t p90 = profile_percentile(buckets, count, max, 0.90);
+      uint64_t p99 = profile_percentile(buckets, count, max, 0.99);
+      fprintf(out, "%6s | %9s | %9llu | %7llu | %7llu | %7llu | %7llu\n",
+              profile_kind_name(kind), name, (unsigned long long)count,
+              (unsigned long long)p50, (unsigned long long)p90,
+              (unsigned long long)p99, (unsigned long long)max);
+    }
+  }
+}
+
+static int profile_compare_blocks(const void* a, const void* b) {
+  uint64_t x = ((const ProfileBlock*)a)->block_plus_one;
+  uint64_t y = ((const ProfileBlock*)b)->block_plus_one;
+  return (x > y) - (x < y);
+}
+
+int profile_write_heatmap(const AccessProfile* profile, const char* path,
+                          int block_words) {
+  if (profile == NULL || profile->blocks.entries == NULL) return -1;
+
+  ProfileBlock* sorted = (ProfileBlock*)malloc(
+      (profile->blocks.count + 1) * sizeof(ProfileBlock));
+  if (sorted == NULL) return -1;
+
+  const ProfileBlock* entries = (const ProfileBlock*)profile->blocks.entries;
+  size_t count = 0;
+  for (size_t i = 0; i < profile->blocks.capacity; i++) {
+    if (entries[i].block_plus_one != 0) sorted[count++] = entries[i];
+  }
+  qsort(sorted, count, sizeof(ProfileBlock), profile_compare_blocks);
+
+  FILE* file = fopen(path, "w");
+  if (file == NULL) {
+    free(sorted);
+    return -1;
+  }
+
+  fprintf(file, "block,first_word,accesses,misses\n");
+  for (size_t i = 0; i < count; i++) {
+    uint64_t block = sorted[i].block_plus_one - 1;
+    fprintf(file, "%llu,%llu,%llu,%llu\n", (unsigned long long)block,
+            (unsigned long long)(block * (uint64_t)block_words),
+            (unsigned long long)sorted[i].accesses,
+            (unsigned long long)sorted[i].misses);
+  }
+
+  free(sorted);
+  return fclose(file) == 0 ? 0 : -1;
+}
@@ -1,13 +1,22 @@
 #include "include/program.h"
 
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
+#include "include/assembler.h"
+#include "include/cli.h"
 #include "include/cpu.h"
 #include "include/instruction.h"
 #include "include/opcodes.h"
 #include "include/ram.h"
+#include "include/profile.h"
+#include "include/reuse.h"
+#include "include/smp.h"
+#include "include/sweep.h"
+#include "include/trace.h"
 #include "include/ucm.h"
 
 #define MEMORY_SIZE 100
@@ -20,7 +29,15 @@ usar uma variavel de controle para quando começar o bloco de instructions.
 sempre fazer o reset do estado da CPU antes de executar (AC, IR, PC, R1, R2)
 */
 
-void program_mult(RAM* ram, Register* reg, int multiplicand, int multiplier) {
+// Programs print their results unless running inside a sweep
+static int program_verbose = 1;
+
+void program_set_verbose(int verbose) {
+  program_verbose = verbose;
+  cpu_set_verbose(verbose);
+}
+
+void program_mult(UCM* ucm, Register* reg, int multiplicand, int multiplier) {
   Instruction inst[MEMORY_SIZE] = {0};
   int pc = 0;
 
@@ -58,22 +75,10 @@ void program_mult(RAM* ram, Register* reg, int multiplicand, int multiplier) {
   reg->R1 = 0;
   reg->R2 = 0;
 
-  // CREATE UCM
-  UCM* ucm = ucm_create(ram);
-
-  while (reg->IR != HALT && reg->PC < MEMORY_SIZE) {
-    execute_cpu(reg, ucm, inst);  // ← PASS UCM!
-  }
-
-  // Print statistics
-  printf("\n=== PROGRAM MULT STATISTICS ===\n");
-  ucm_print_stats(ucm);
-
-  // Cleanup
-  ucm_destroy(ucm);
+  cpu_run(reg, ucm, inst, MEMORY_SIZE, 0);
 }
 
-void program_fibonacci(RAM* ram, Register* reg, int term) {
+void program_fibonacci(UCM* ucm, Register* reg, int term) {
   Instruction inst[MEMORY_SIZE] = {0};
   int pc = 0;
 
@@ -106,27 +111,23 @@ void program_fibonacci(RAM* ram, Register* reg, int term) {
   reg->R1 = 0;
   reg->R2 = 0;
 
-  // CREATE UCM
-  UCM* ucm = ucm_create(ram);
-
-  while (reg->IR != HALT && reg->PC < MEMORY_SIZE) {
-    execute_cpu(reg, ucm, inst);  // ← PASS UCM!
-  }
-
-  // Print statistics
-  printf("\n=== PROGRAM FIBONACCI STATISTICS ===\n");
-  ucm_print_stats(ucm);
-
-  // Cleanup
-  ucm_destroy(ucm);
+  cpu_run(reg, ucm, inst, MEMORY_SIZE, 0);
 }
 
-void program_sum_matrix(RAM* ram, Register* reg, int size) {
+void program_sum_matrix(UCM* ucm, Register* reg, int size) {
   Instruction inst[MEMORY_SIZE] = {0};
+  RAM* ram = ucm->ram;
 
   int n_elements = size * size;
   int delta = n_elements;
 
+  // One ADD per element plus HALT must fit in the instruction memory
+  if (n_elements + 1 > MEMORY_SIZE) {
+    printf("Error: %dx%d matrices need more than %d instructions\n", size,
+           size, MEMORY_SIZE);
+    return;
+  }
+
   srand(time(NULL));
 
   // Pre-load matrices (acceptable for test setup)
@@ -151,12 +152,9 @@ void program_sum_matrix(RAM* ram, Register* reg, int size) {
   reg->R1 = 0;
   reg->R2 = 0;
 
-  // CREATE UCM
-  UCM* ucm = ucm_create(ram);
+  cpu_run(reg, ucm, inst, MEMORY_SIZE, 0);
 
-  while (reg->IR != HALT && reg->PC < MEMORY_SIZE) {
-    execute_cpu(reg, ucm, inst);  // ← PASS UCM!
-  }
+  if (!program_verbose) return;
 
   // Print matrices
   printf("Matriz A\n");
@@ -175,16 +173,9 @@ void program_sum_matrix(RAM* ram, Register* reg, int size) {
     printf("\n");
   }
   printf("\n");
-
-  // Print statistics
-  printf("\n=== PROGRAM SUM MATRIX STATISTICS ===\n");
-  ucm_print_stats(ucm);
-
-  // Cleanup
-  ucm_destroy(ucm);
 }
 
-void program_div(RAM* ram, Register* reg, int dividend, int divisor) {
+void program_div(UCM* ucm, Register* reg, int dividend, int divisor) {
   Instruction inst[MEMORY_SIZE] = {0};
   int pc = 0;
 
@@ -220,24 +211,13 @@ void program_div(RAM* ram, Register* reg, int dividend, int divisor) {
   reg->R1 = 0;
   reg->R2 = 0;
 
-  // CREATE UCM
-  UCM* ucm = ucm_create(ram);
-
-  while (reg->IR != HALT && reg->PC < MEMORY_SIZE) {
-    execute_cpu(reg, ucm, inst);  // ← PASS UCM!
-  }
-
-  // Print statistics
-  printf("\n=== PROGRAM DIV STATISTICS ===\n");
-  ucm_print_stats(ucm);
-
-  // Cleanup
-  ucm_destroy(ucm);
+  cpu_run(reg, ucm, inst, MEMORY_SIZE, 0);
 }
 
 // n (n × (n-1) × (n-2) × ... × 2 × 1).
-void program_fat(RAM* ram, Register* reg, int n) {
+void program_fat(UCM* ucm, Register* reg, int n) {
   Instruction inst[MEMORY_SIZE] = {0};
+  RAM* ram = ucm->ram;
   int pc = 0;
 
   // Initialize RAM via instructions (CORRECT WAY)
@@ -270,29 +250,25 @@ void program_fat(RAM* ram, Register* reg, int n) {
   reg->R1 = 0;
   reg->R2 = 0;
 
-  // CREATE UCM
-  UCM* ucm = ucm_create(ram);
+  cpu_run(reg, ucm, inst, MEMORY_SIZE, 0);
 
-  while (reg->IR != HALT && reg->PC < MEMORY_SIZE) {
-    execute_cpu(reg, ucm, inst);  // ← PASS UCM!
+  if (program_verbose) {
+    ucm_flush(ucm);  // RAM must see stores still sitting in write-back lines
+    printf("Fatorial de %d = %d\n", n, get_ram(ram, 0));
   }
-
-  printf("Fatorial de %d = %d\n", n, get_ram(ram, 0));
-
-  // Print statistics
-  printf("\n=== PROGRAM FAT STATISTICS ===\n");
-  ucm_print_stats(ucm);
-
-  // Cleanup
-  ucm_destroy(ucm);
 }
 
 // Adicione no src/program.c
 
 // Matrix multiplication:  C = A × B (size × size matrices)
 // Acessa MUITA memória, causa muitos cache misses!
-void program_matrix_mult(RAM* ram, Register* reg, int size) {
-  printf("\n=== PROGRAM MATRIX MULTIPLICATION (%dx%d) ===\n\n", size, size);
+void program_matrix_mult(UCM* ucm, Register* reg, int size) {
+  (void)reg;  // Driven from the host, not by CPU instructions
+  RAM* ram = ucm->ram;
+
+  if (program_verbose) {
+    printf("\n=== PROGRAM MATRIX MULTIPLICATION (%dx%d) ===\n\n", size, size);
+  }
 
   // Memory layout:
   // Matrix A:  RAM[0] to RAM[size*size-1]
@@ -310,31 +286,35 @@ void program_matrix_mult(RAM* ram, Register* reg, int size) {
     set_ram(ram, base_c + i, 0);             // C[i] = 0
   }
 
-  printf("Matrices initialized.  Starting multiplication...\n");
-
-  UCM* ucm = ucm_create(ram);
-  if (ucm == NULL) {
-    printf("Error:  Could not create UCM\n");
-    return;
+  if (program_verbose) {
+    printf("Matrices initialized.  Starting multiplication...\n");
   }
 
   ucm_reset_stats(ucm);
 
+  // Reads of one dot product, A[i][k] and B[k][j] alternating
+  uint64_t* addresses = (uint64_t*)malloc(2 * (size_t)size * sizeof(uint64_t));
+  int* values = (int*)malloc(2 * (size_t)size * sizeof(int));
+  if (addresses == NULL || values == NULL) {
+    free(addresses);
+    free(values);
+    return;
+  }
+
   // Matrix multiplication:  C[i][j] = sum(A[i][k] * B[k][j])
   for (int i = 0; i < size; i++) {
     for (int j = 0; j < size; j++) {
-      int sum = 0;
-
       for (int k = 0; k < size; k++) {
-        // Access A[i][k]
-        int a_addr = base_a + (i * size + k);
-        int a_val = ucm_access(ucm, a_addr, UCM_READ, 0);
-
-        // Access B[k][j]
-        int b_addr = base_b + (k * size + j);
-        int b_val = ucm_access(ucm, b_addr, UCM_READ, 0);
+        addresses[2 * k] = base_a + (i * size + k);
+        addresses[2 * k + 1] = base_b + (k * size + j);
+      }
+      ucm_overlap_begin(ucm);  // The dot product's loads are independent
+      ucm_access_batch(ucm, addresses, NULL, NULL, values, 2 * (size_t)size);
+      ucm_overlap_end(ucm);
 
-        sum += a_val * b_val;
+      int sum = 0;
+      for (int k = 0; k < size; k++) {
+        sum += values[2 * k] * values[2 * k + 1];
       }
 
       // Write C[i][j]
@@ -343,41 +323,469 @@ void program_matrix_mult(RAM* ram, Register* reg, int size) {
     }
   }
 
+  free(addresses);
+  free(values);
+
+  if (!program_verbose) return;
+
   printf("program endeed\n");
-  ucm_print_stats(ucm);
 
   // Show sample result
+  ucm_flush(ucm);
   int c00 = get_ram(ram, base_c);
   printf("C[0][0] = %d\n", c00);
+}
 
-  ucm_destroy(ucm);
+// Adapters so every program can be started the same way
+static void run_mult(UCM* ucm, Register* reg, int arg1, int arg2) {
+  program_mult(ucm, reg, arg1, arg2);
+}
+
+static void run_div(UCM* ucm, Register* reg, int arg1, int arg2) {
+  program_div(ucm, reg, arg1, arg2);
+}
+
+static void run_fat(UCM* ucm, Register* reg, int arg1, int arg2) {
+  (void)arg2;
+  program_fat(ucm, reg, arg1);
+}
+
+static void run_sum_matrix(UCM* ucm, Register* reg, int arg1, int arg2) {
+  (void)arg2;
+  program_sum_matrix(ucm, reg, arg1);
+}
+
+static void run_fibonacci(UCM* ucm, Register* reg, int arg1, int arg2) {
+  (void)arg2;
+  program_fibonacci(ucm, reg, arg1);
+}
+
+static void run_matrix_mult(UCM* ucm, Register* reg, int arg1, int arg2) {
+  (void)arg2;
+  program_matrix_mult(ucm, reg, arg1);
+}
+
+static const ProgramInfo programs[] = {
+    {"mult", "MULT", run_mult, 2, {10, 10}, 0},
+    {"fibonacci", "FIBONACCI", run_fibonacci, 1, {10, 0}, 0},
+    {"sum_matrix", "SUM MATRIX", run_sum_matrix, 1, {9, 0}, -1},
+    {"matrix_mult", "MATRIX MULT", run_matrix_mult, 1, {10, 0}, -1},
+    {"div", "DIV", run_div, 2, {10, 2}, 3},
+    {"fat", "FAT", run_fat, 1, {10, 0}, -1},
+};
+
+#define NUM_PROGRAMS (int)(sizeof(programs) / sizeof(programs[0]))
+
+// Program given with --program-file (read-only, shared by sweep threads)
+static ProgramImage* loaded_image = NULL;
+static ProgramInfo loaded_program = {"file", "FILE", NULL, 0, {0, 0}, -1};
+
+static void run_loaded(UCM* ucm, Register* reg, int arg1, int arg2) {
+  (void)arg1;
+  (void)arg2;
+
+  program_image_load_data(loaded_image, ucm->ram);
+
+  reg->AC = 0;
+  reg->IR = 0;
+  reg->PC = 0;
+  reg->R1 = 0;
+  reg->R2 = 0;
+
+  cpu_run(reg, ucm, loaded_image->code, loaded_image->length, 0);
 }
 
-int main(void) {
+const ProgramInfo* program_load_file(const char* path) {
+  program_unload_file();
+
+  loaded_image = program_image_open(path);
+  if (loaded_image == NULL) return NULL;
+
+  loaded_program.run = run_loaded;
+  loaded_program.result_address = (loaded_image->result_address <= INT_MAX)
+                                      ? (int)loaded_image->result_address
+                                      : -1;
+  return &loaded_program;
+}
+
+void program_unload_file(void) {
+  program_image_close(loaded_image);
+  loaded_image = NULL;
+}
+
+const ProgramInfo* program_find(const char* name) {
+  if (name == NULL) return NULL;
+
+  for (int i = 0; i < NUM_PROGRAMS; i++) {
+    if (strcmp(programs[i].name, name) == 0) {
+      return &programs[i];
+    }
+  }
+
+  return NULL;
+}
+
+void program_print_list(void) {
+  for (int i = 0; i < NUM_PROGRAMS; i++) {
+    printf("  %-12s (%d arg%s, default", programs[i].name,
+           programs[i].num_args, programs[i].num_args > 1 ? "s" : "");
+    for (int j = 0; j < programs[i].num_args; j++) {
+      printf(" %d", programs[i].default_args[j]);
+    }
+    printf(")\n");
+  }
+}
+
+// Where the --stats report goes (NULL if the file could not be created)
+static FILE* open_stats_output(const CliOptions* options) {
+  if (options->stats_file == NULL) return stdout;
+
+  FILE* out = fopen(options->stats_file, "w");
+  if (out == NULL) {
+    fprintf(stderr, "Error: could not create stats file '%s'\n",
+            options->stats_file);
+  }
+  return out;
+}
+
+static void close_stats_output(FILE* out) {
+  if (out != NULL && out != stdout) fclose(out);
+}
+
+// Where the run's own notes go: stderr when a JSON/CSV report takes stdout,
+// so the report stays parseable
+static FILE* notes_output(const CliOptions* options) {
+  return (options->stats_format != STATS_BOX && options->stats_file == NULL)
+             ? stderr
+             : stdout;
+}
+
+// --cores N: the program (or the trace) on every core of one system
+static int run_multicore(const CliOptions* options,
+                         const ProgramInfo* program, int arg1, int arg2,
+                         const TraceReader* trace, RAM* ram) {
+  SmpSystem* smp = smp_create(ram, &options->config, options->cores);
+  if (smp == NULL) {
+    fprintf(stderr,
+            "Error: invalid multi-core hierarchy (needs 2+ levels; no "
+            "fetch, victim cache, prefetch or MSHRs)\n");
+    return 1;
+  }
+
+  smp_run(smp, program, arg1, arg2, trace, options->threads);
+
+  if (trace == NULL && program->result_address >= 0) {
+    smp_flush(smp);
+    fprintf(notes_output(options), "Resultado = %d\n",
+            get_ram(ram, program->result_address));
+  }
+
+  if (options->save_image != NULL) {
+    smp_flush(smp);
+    if (ram_save_image(ram, options->save_image) != 0) {
+      fprintf(stderr, "Error: could not save RAM image '%s'\n",
+              options->save_image);
+    }
+  }
+
+  if (options->stats_format == STATS_BOX) {
+    if (trace != NULL) {
+      printf("\n=== TRACE REPLAY STATISTICS (%d CORES) ===\n",
+             smp->num_cores);
+    } else {
+      printf("\n=== PROGRAM %s STATISTICS (%d CORES) ===\n", program->title,
+             smp->num_cores);
+    }
+    smp_print_stats(smp);
+  } else {
+    FILE* out = open_stats_output(options);
+    if (out != NULL) smp_print_stats_format(smp, out, options->stats_format);
+    close_stats_output(out);
+  }
+
+  smp_destroy(smp);
+  return 0;
+}
+
+// With --fetch the code is copied to [code_base, end); it must fit in the
+// RAM and stay clear of the program's .word data
+static int check_code_region(const ProgramInfo* program, uint64_t code_base,
+                             const RAM* ram) {
+  int length = (program == &loaded_program) ? loaded_image->length
+                                            : MEMORY_SIZE;
+  uint64_t end = code_base + (uint64_t)length * CPU_INSTRUCTION_WORDS;
+
+  if (!cpu_code_fits(ram, code_base, length)) {
+    fprintf(stderr,
+            "Error: code region [%llu, %llu) does not fit in %llu words of "
+            "RAM (see --code-base)\n",
+            (unsigned long long)code_base, (unsigned long long)end,
+            (unsigned long long)ram->num_words);
+    return -1;
+  }
+  if (program == &loaded_program &&
+      program_image_data_overlaps(loaded_image, code_base, end)) {
+    fprintf(stderr,
+            "Error: .word data overlaps the code region [%llu, %llu) "
+            "(see --code-base)\n",
+            (unsigned long long)code_base, (unsigned long long)end);
+    return -1;
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  CliOptions options;
+  if (cli_parse(argc, argv, &options) != 0) {
+    return 1;
+  }
+  if (options.help) {
+    cli_print_usage(argv[0]);
+    return 0;
+  }
+  if (options.stats_file != NULL && options.stats_format == STATS_BOX) {
+    fprintf(stderr, "Error: --stats-file needs --stats json or csv\n");
+    return 1;
+  }
+  // The programs print as they run; keep that off a JSON/CSV stdout
+  FILE* notes = notes_output(&options);
+  if (notes != stdout) program_set_verbose(0);
+  if (options.cores > 1 &&
+      (options.record_path != NULL || options.mrc_lines > 0 ||
+       options.histogram || options.heatmap_path != NULL ||
+       options.sweep_file != NULL || options.grid_lines != NULL ||
+       options.grid_latency != NULL || options.grid_assoc != NULL)) {
+    fprintf(stderr, "Error: --cores does not combine with --record, --mrc, "
+                    "--histogram, --heatmap or sweeps\n");
+    return 1;
+  }
+
+  if (options.assemble != NULL) {
+    if (options.output == NULL) {
+      fprintf(stderr, "Error: --assemble needs --output FILE\n");
+      return 1;
+    }
+    return (assembler_build(options.assemble, options.output) == 0) ? 0 : 1;
+  }
+
+  const ProgramInfo* program = NULL;
+  if (options.program_file != NULL) {
+    program = program_load_file(options.program_file);
+    if (program == NULL) {
+      fprintf(stderr, "Error: could not load program '%s'\n",
+              options.program_file);
+      return 1;
+    }
+  } else {
+    program = program_find(options.program);
+  }
+  if (program == NULL) {
+    fprintf(stderr, "Error: unknown program '%s'\n", options.program);
+    return 1;
+  }
+
+  int arg1 = program->default_args[0];
+  int arg2 = program->default_args[1];
+  if (options.num_args > 0) arg1 = options.args[0];
+  if (options.num_args > 1) arg2 = options.args[1];
+
+  TraceReader* trace = NULL;
+  if (options.replay_path != NULL) {
+    trace = trace_reader_open(options.replay_path);
+    if (trace == NULL) {
+      fprintf(stderr, "Error: could not read trace '%s'\n",
+              options.replay_path);
+      program_unload_file();
+      return 1;
+    }
+  }
+
+  // Sweep mode: one row per hierarchy instead of the full report
+  if (options.sweep_file != NULL || options.grid_lines != NULL ||
+      options.grid_latency != NULL || options.grid_assoc != NULL) {
+    SweepPoint* points = NULL;
+    int count = 0;
+    int status =
+        (options.sweep_file != NULL)
+            ? sweep_load_file(options.sweep_file, &options.config, &points,
+                              &count)
+            : sweep_build_grid(&options.config, options.grid_lines,
+                               options.grid_latency, options.grid_assoc,
+                               &points, &count);
+    if (status != 0) {
+      fprintf(stderr, "Error: invalid sweep specification\n");
+      free(points);
+      trace_reader_close(trace);
+      program_unload_file();
+      return 1;
+    }
+
+    sweep_run(points, count, program, arg1, arg2, trace, options.threads);
+    if (options.stats_format == STATS_BOX) {
+      sweep_print_table(stdout, points, count);
+    } else {
+      FILE* out = open_stats_output(&options);
+      if (out != NULL) {
+        sweep_print_stats(out, points, count, options.stats_format);
+      }
+      close_stats_output(out);
+    }
+    free(points);
+    trace_reader_close(trace);
+    program_unload_file();
+    return 0;
+  }
+
+  // A trace may touch more memory than the programs' RAM
+  uint64_t ram_words = options.config.ram_words;
+  if (trace != NULL && trace->max_address + 1 > ram_words) {
+    ram_words = trace->max_address + 1;
+  }
+
   Register reg = {0, 0, 0, 0, 0};
-  RAM* ram = create_empty_ram(MEMORY_SIZE);
+  RAM* ram = ucm_create_ram(&options.config, ram_words);
+  if (ram == NULL) {
+    fprintf(stderr,
+            "Error: could not create RAM (swap file, page size or image)\n");
+    trace_reader_close(trace);
+    program_unload_file();
+    return 1;
+  }
+
+  if (options.cores > 1) {
+    int status = run_multicore(&options, program, arg1, arg2, trace, ram);
+    destroy_ram(ram);
+    trace_reader_close(trace);
+    program_unload_file();
+    return status;
+  }
+
+  if (trace == NULL && options.config.fetch &&
+      check_code_region(program, options.config.code_base, ram) != 0) {
+    destroy_ram(ram);
+    program_unload_file();
+    return 1;
+  }
+
+  UCM* ucm = ucm_create_with_config(ram, &options.config);
+  if (ucm == NULL) {
+    fprintf(stderr, "Error: invalid memory hierarchy configuration\n");
+    destroy_ram(ram);
+    trace_reader_close(trace);
+    program_unload_file();
+    return 1;
+  }
+
+  if (options.record_path != NULL) {
+    ucm->trace = trace_writer_open(options.record_path);
+    if (ucm->trace == NULL) {
+      fprintf(stderr, "Error: could not create trace '%s'\n",
+              options.record_path);
+    }
+  }
+
+  if (options.mrc_lines > 0) {
+    // Cover the configured levels too, so their rates can be predicted
+    int max_distance = options.mrc_lines;
+    for (int level = 0; level < ucm->num_levels; level++) {
+      if (ucm->levels[level]->num_lines > max_distance) {
+        max_distance = ucm->levels[level]->num_lines;
+      }
+    }
+    ucm->reuse = reuse_create(max_distance);
+    if (ucm->reuse == NULL) {
+      fprintf(stderr, "Error: could not allocate the reuse analyzer\n");
+    }
+  }
 
-  // PROGRAM:  1
-  // program_mult(ram, &reg, 10, 10);
-  // printf("Resultado = %d\n", get_ram(ram, 0));
+  if (options.histogram || options.heatmap_path != NULL) {
+    ucm->profile = profile_create(options.heatmap_path != NULL);
+    if (ucm->profile == NULL) {
+      fprintf(stderr, "Error: could not allocate the access profile\n");
+    }
+  }
 
-  // PROGRAM: 2
-  // program_fibonacci(ram, &reg, 10);
-  // printf("Resultado = %d\n", get_ram(ram, 0));
+  if (trace != NULL) {
+    clock_t start = clock();
+    uint64_t replayed = trace_replay(trace, ucm);
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
 
-  // PROGRAM: 3
-  // program_sum_matrix(ram, &reg, 100);
+    fprintf(notes, "Replayed %llu accesses in %.3f s",
+            (unsigned long long)replayed, seconds);
+    if (seconds > 0.0) {
+      fprintf(notes, " (%.1f M accesses/s)", (double)replayed / seconds / 1e6);
+    }
+    fprintf(notes, "\n");
+    if (options.stats_format == STATS_BOX) {
+      printf("\n=== TRACE REPLAY STATISTICS ===\n");
+    }
+  } else {
+    program->run(ucm, &reg, arg1, arg2);
 
-  // PROGRAM MULT MATRIX
-  program_matrix_mult(ram, &reg, 10);  // 10x10 matrix
+    if (program->result_address >= 0) {
+      ucm_flush(ucm);
+      fprintf(notes, "Resultado = %d\n", get_ram(ram, program->result_address));
+    }
 
-  // PROGRAM: 4
-  // program_div(ram, &reg, 10, 2);
-  // printf("Resultado = %d\n", get_ram(ram, 3));
+    if (options.stats_format == STATS_BOX) {
+      printf("\n=== PROGRAM %s STATISTICS ===\n", program->title);
+    }
+  }
 
-  // PROGRAM: 5
-  // program_fat(ram, &reg, 10);
+  if (options.save_image != NULL) {
+    ucm_flush(ucm);
+    if (ram_save_image(ram, options.save_image) != 0) {
+      fprintf(stderr, "Error: could not save RAM image '%s'\n",
+              options.save_image);
+    }
+  }
 
+  // Print statistics
+  if (options.stats_format == STATS_BOX) {
+    ucm_print_stats(ucm);
+  } else {
+    UCMStats stats;
+    ucm_get_stats(ucm, &stats);
+
+    FILE* out = open_stats_output(&options);
+    if (out != NULL && options.stats_format == STATS_JSON) {
+      stats_print_json(out, &stats);
+      fprintf(out, "\n");
+    } else if (out != NULL) {
+      stats_print_csv_header(out, stats.num_levels);
+      stats_print_csv_row(out, &stats, stats.num_levels);
+    }
+    close_stats_output(out);
+  }
+
+  if (ucm->reuse != NULL) {
+    reuse_print_curve(ucm->reuse, notes, options.mrc_lines);
+    reuse_print_levels(ucm->reuse, notes, ucm);
+    reuse_destroy(ucm->reuse);
+    ucm->reuse = NULL;
+  }
+
+  if (ucm->profile != NULL) {
+    if (options.histogram) profile_print_latency(ucm->profile, notes);
+    if (options.heatmap_path != NULL &&
+        profile_write_heatmap(ucm->profile, options.heatmap_path,
+                              ucm->block.words) != 0) {
+      fprintf(stderr, "Error: could not write heatmap '%s'\n",
+              options.heatmap_path);
+    }
+    profile_destroy(ucm->profile);
+    ucm->profile = NULL;
+  }
+
+  if (ucm->trace != NULL) {
+    trace_writer_close(ucm->trace);
+    ucm->trace = NULL;
+  }
+
+  // Cleanup
+  ucm_destroy(ucm);
   destroy_ram(ram);
+  trace_reader_close(trace);
+  program_unload_file();
   return 0;
-}
\ No newline at end of file
+}
@@ -1,99 +1,583 @@
+#define _GNU_SOURCE  // pread, pwrite, mkstemp, mmap, SEEK_DATA
+
 #include "include/ram.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define RAM_INITIAL_PAGES 64
+#define RAM_IMAGE_MAGIC "UCMRAM\0\0"
+#define RAM_IMAGE_VERSION 2
+#define RAM_IMAGE_VERSION_BLOCKS 1  // Offset 12 held words per block
+
+// Entry of `page`, created if `create` (NULL if absent or out of memory)
+static RAMPage* page_lookup(RAM* ram, uint64_t page, int create) {
+  if (!create) return (RAMPage*)blockmap_find(&ram->pages, page);
 
-static size_t calculate_num_blocks(size_t num_words) {
-  // Round up:   (num_words + 3) / 4
-  return (num_words + WORDS_PER_BLOCK - 1) / WORDS_PER_BLOCK;
+  int added;
+  RAMPage* entry = (RAMPage*)blockmap_insert(&ram->pages, page, &added);
+  if (entry != NULL && added) {
+    entry->words = NULL;
+    entry->frame = -1;
+    entry->on_disk = 0;
+    entry->mapped = 0;
+  }
+  return entry;
 }
 
-RAM* create_ram(size_t size) {
-  RAM* ram = (RAM*)malloc(sizeof(RAM));
+static RAM* ram_alloc(uint64_t size, size_t page_words) {
+  if (page_words == 0) return NULL;
+
+  RAM* ram = (RAM*)calloc(1, sizeof(RAM));
   if (ram == NULL) return NULL;
-  
+
+  ram->swap_fd = -1;
+  ram->image_fd = -1;
   ram->num_words = size;
-  ram->num_blocks = calculate_num_blocks(size);
-  
-  // Allocate blocks
-  ram->blocks = (Block*)malloc(ram->num_blocks * sizeof(Block));
-  if (ram->blocks == NULL) {
+  ram->page_words = page_words;
+
+  if (blockmap_init(&ram->pages, sizeof(RAMPage), RAM_INITIAL_PAGES) != 0) {
     free(ram);
     return NULL;
   }
-  
-  // Initialize all blocks to zero
-  for (size_t i = 0; i < ram->num_blocks; i++) {
-    block_init(&ram->blocks[i]);
+
+  return ram;
+}
+
+RAM* create_ram(uint64_t size) {
+  // Pages are allocated as they are first written
+  return ram_alloc(size, RAM_PAGE_WORDS);
+}
+
+// Anonymous file for the pages that do not fit: unlinked right away, so
+// it goes away with the descriptor
+static int open_swap_file(void) {
+  const char* dir = getenv("TMPDIR");
+  if (dir == NULL || *dir == '\0') dir = "/var/tmp";
+
+  char path[512];
+  snprintf(path, sizeof(path), "%s/ucm-swap-XXXXXX", dir);
+  int fd = mkstemp(path);
+  if (fd >= 0) unlink(path);
+
+  return fd;
+}
+
+RAM* create_swapped_ram(uint64_t size, size_t num_frames, size_t page_words,
+                        RAM_PagePolicy policy) {
+  if (num_frames == 0) return create_ram(size);
+
+  RAM* ram = ram_alloc(size, page_words);
+  if (ram == NULL) return NULL;
+
+  ram->num_frames = num_frames;
+  ram->page_policy = policy;
+  ram->swap_fd = open_swap_file();
+
+  // Only the frames are backed by memory
+  ram->frames = (int*)calloc(num_frames * ram->page_words, sizeof(int));
+  ram->frame_page = (uint64_t*)calloc(num_frames, sizeof(uint64_t));
+  ram->frame_used = (unsigned char*)calloc(num_frames, 1);
+  ram->frame_stamp = (uint64_t*)calloc(num_frames, sizeof(uint64_t));
+  ram->frame_referenced = (unsigned char*)calloc(num_frames, 1);
+  ram->frame_dirty = (unsigned char*)calloc(num_frames, 1);
+
+  if (ram->swap_fd < 0 || ram->frames == NULL || ram->frame_page == NULL ||
+      ram->frame_used == NULL || ram->frame_stamp == NULL ||
+      ram->frame_referenced == NULL || ram->frame_dirty == NULL) {
+    destroy_ram(ram);
+    return NULL;
   }
-  
+
   return ram;
 }
 
-RAM* create_empty_ram(size_t size) {
+// Words at the start of `page` that come from the loaded image
+static size_t image_words_in_page(const RAM* ram, uint64_t page) {
+  uint64_t first = page * ram->page_words;
+  if (first >= ram->image_words) return 0;
+
+  uint64_t available = ram->image_words - first;
+  return (available < ram->page_words) ? (size_t)available : ram->page_words;
+}
+
+// Initial contents of `page`: the image where it covers it, zeros after
+static void image_copy_page(const RAM* ram, uint64_t page, int* dest) {
+  size_t from_image = image_words_in_page(ram, page);
+  if (from_image > 0) {
+    memcpy(dest, &ram->image[page * ram->page_words],
+           from_image * sizeof(int));
+  }
+  memset(dest + from_image, 0, (ram->page_words - from_image) * sizeof(int));
+}
+
+// pread/pwrite may move less than asked for; loop until the page is done
+static int swap_io(RAM* ram, uint64_t page, int* frame_words, int write) {
+  size_t bytes = ram->page_words * sizeof(int);
+  off_t offset = (off_t)(page * bytes);
+  char* buffer = (char*)frame_words;
+  size_t done = 0;
+
+  while (done < bytes) {
+    ssize_t n = write ? pwrite(ram->swap_fd, buffer + done, bytes - done,
+                               offset + (off_t)done)
+                      : pread(ram->swap_fd, buffer + done, bytes - done,
+                              offset + (off_t)done);
+    if (n <= 0) {
+      perror("swap");
+      return -1;
+    }
+    done += (size_t)n;
+  }
+
+  return 0;
+}
+
+static size_t ram_choose_frame(RAM* ram) {
+  for (size_t frame = 0; frame < ram->num_frames; frame++) {
+    if (!ram->frame_used[frame]) return frame;
+  }
+
+  if (ram->page_policy == RAM_PAGE_CLOCK) {
+    // Give every referenced page a second chance
+    while (ram->frame_referenced[ram->clock_hand]) {
+      ram->frame_referenced[ram->clock_hand] = 0;
+      ram->clock_hand = (ram->clock_hand + 1) % ram->num_frames;
+    }
+    size_t victim = ram->clock_hand;
+    ram->clock_hand = (ram->clock_hand + 1) % ram->num_frames;
+    return victim;
+  }
+
+  // LRU and FIFO differ only in when the stamp is set
+  size_t victim = 0;
+  for (size_t frame = 1; frame < ram->num_frames; frame++) {
+    if (ram->frame_stamp[frame] < ram->frame_stamp[victim]) victim = frame;
+  }
+  return victim;
+}
+
+// Bring `entry` into a frame, writing the page it replaces out if dirty.
+// Returns the frame, -1 if the swap file failed.
+static long ram_page_in(RAM* ram, RAMPage* entry) {
+  size_t frame = ram_choose_frame(ram);
+  int* frame_words = &ram->frames[frame * ram->page_words];
+
+  if (ram->frame_used[frame]) {
+    uint64_t old_number = ram->frame_page[frame];
+    RAMPage* old = page_lookup(ram, old_number, 0);
+
+    if (ram->frame_dirty[frame]) {
+      if (swap_io(ram, old_number, frame_words, 1) != 0) return -1;
+      ram->disk_writes++;
+      old->on_disk = 1;
+    }
+    old->words = NULL;
+    old->frame = -1;
+  }
+
+  uint64_t number = entry->number_plus_one - 1;
+  ram->page_faults++;
+  if (entry->on_disk) {
+    if (swap_io(ram, number, frame_words, 0) != 0) return -1;
+    ram->disk_reads++;
+  } else {
+    // Never written out: still what the image (or nothing) says
+    image_copy_page(ram, number, frame_words);
+  }
+
+  entry->words = frame_words;
+  entry->frame = (long)frame;
+  ram->frame_page[frame] = number;
+  ram->frame_used[frame] = 1;
+  ram->frame_stamp[frame] = ++ram->tick;
+  ram->frame_referenced[frame] = 1;
+  ram->frame_dirty[frame] = 0;
+
+  return (long)frame;
+}
+
+// Give a page without swap its storage. Reads of a page the image covers
+// whole go straight to the mapping; the first write makes a private copy.
+static int ram_page_alloc(RAM* ram, RAMPage* entry, int write) {
+  uint64_t number = entry->number_plus_one - 1;
+
+  if (!write && image_words_in_page(ram, number) == ram->page_words) {
+    entry->words = (int*)&ram->image[number * ram->page_words];
+    entry->mapped = 1;
+    return 0;
+  }
+
+  int* copy = (int*)malloc(ram->page_words * sizeof(int));
+  if (copy == NULL) return -1;
+  image_copy_page(ram, number, copy);
+
+  entry->words = copy;
+  entry->mapped = 0;
+  return 0;
+}
+
+// Where word `memory_address` lives right now, allocating or paging it in
+// if needed. Without swap, reading a page that was never written and is
+// not in the image returns NULL (all zeros) instead of allocating it.
+static int* ram_word(RAM* ram, uint64_t memory_address, int write) {
+  uint64_t page = memory_address / ram->page_words;
+  size_t index = (size_t)(memory_address % ram->page_words);
+
+  int create = write || ram->num_frames > 0 ||
+               image_words_in_page(ram, page) > 0;
+  RAMPage* entry = page_lookup(ram, page, create);
+  if (entry == NULL) return NULL;
+
+  if (ram->num_frames == 0) {
+    if ((entry->words == NULL || (write && entry->mapped)) &&
+        ram_page_alloc(ram, entry, write) != 0) {
+      return NULL;
+    }
+    return &entry->words[index];
+  }
+
+  if (entry->frame < 0 && ram_page_in(ram, entry) < 0) return NULL;
+
+  long frame = entry->frame;
+  if (ram->page_policy == RAM_PAGE_LRU) ram->frame_stamp[frame] = ++ram->tick;
+  ram->frame_referenced[frame] = 1;
+  if (write) ram->frame_dirty[frame] = 1;
+
+  return &entry->words[index];
+}
+
+RAM* create_empty_ram(uint64_t size) {
   return create_ram(size);
 }
 
-RAM* create_random_ram(size_t size) {
+RAM* create_random_ram(uint64_t size) {
   RAM* ram = create_ram(size);
   if (ram == NULL) return NULL;
-  
+
   // Fill with random values
-  for (size_t i = 0; i < size; i++) {
+  for (uint64_t i = 0; i < size; i++) {
     set_ram(ram, i, rand() % 100);  // Random 0-99
   }
-  
+
   return ram;
 }
 
-int get_ram(RAM* ram, size_t memory_address) {
+// A RAM shared by several threads takes one call at a time
+static void ram_lock(RAM* ram) {
+  if (ram->lock != NULL) pthread_mutex_lock(ram->lock);
+}
+
+static void ram_unlock(RAM* ram) {
+  if (ram->lock != NULL) pthread_mutex_unlock(ram->lock);
+}
+
+int get_ram(RAM* ram, uint64_t memory_address) {
   if (ram == NULL || memory_address >= ram->num_words) {
     return 0;  // Error: out of bounds
   }
-  
-  // Convert word address to block + offset
-  size_t block_address = word_to_block(memory_address);
-  size_t word_offset = word_to_offset(memory_address);
-  
-  // Get from the block
-  return block_get_word(&ram->blocks[block_address], word_offset);
+
+  ram_lock(ram);
+  int* word = ram_word(ram, memory_address, 0);
+  int value = (word != NULL) ? *word : 0;
+  ram_unlock(ram);
+  return value;
 }
 
-void set_ram(RAM* ram, size_t memory_address, int new_memory_value) {
+void set_ram(RAM* ram, uint64_t memory_address, int new_memory_value) {
   if (ram == NULL || memory_address >= ram->num_words) {
     return;  // Error: out of bounds
   }
-  
-  // Convert word address to block + offset
-  size_t block_address = word_to_block(memory_address);
-  size_t word_offset = word_to_offset(memory_address);
-  
-  // Set in the block
-  block_set_word(&ram->blocks[block_address], word_offset, new_memory_value);
+
+  ram_lock(ram);
+  int* word = ram_word(ram, memory_address, 1);
+  if (word != NULL) *word = new_memory_value;
+  ram_unlock(ram);
+}
+
+void get_ram_words(RAM* ram, uint64_t memory_address, int* dest,
+                   size_t count) {
+  if (ram == NULL || dest == NULL) return;
+
+  ram_lock(ram);
+
+  // One page at a time; words past the end of the address space read 0
+  while (count > 0) {
+    size_t index = (size_t)(memory_address % ram->page_words);
+    size_t chunk = ram->page_words - index;
+    if (chunk > count) chunk = count;
+
+    int* words = (memory_address < ram->num_words)
+                     ? ram_word(ram, memory_address, 0)
+                     : NULL;
+    if (words != NULL) {
+      memcpy(dest, words, chunk * sizeof(int));
+    } else {
+      memset(dest, 0, chunk * sizeof(int));
+    }
+
+    memory_address += chunk;
+    dest += chunk;
+    count -= chunk;
+  }
+
+  ram_unlock(ram);
 }
 
-void get_ram_block(RAM* ram, size_t block_address, Block* dest) {
-  if (ram == NULL || dest == NULL || block_address >= ram->num_blocks) {
-    return;  // Error
+void set_ram_words(RAM* ram, uint64_t memory_address, const int* src,
+                   size_t count) {
+  if (ram == NULL || src == NULL) return;
+
+  ram_lock(ram);
+  while (count > 0 && memory_address < ram->num_words) {
+    size_t index = (size_t)(memory_address % ram->page_words);
+    size_t chunk = ram->page_words - index;
+    if (chunk > count) chunk = count;
+
+    int* words = ram_word(ram, memory_address, 1);
+    if (words != NULL) memcpy(words, src, chunk * sizeof(int));
+
+    memory_address += chunk;
+    src += chunk;
+    count -= chunk;
   }
-  
-  // Copy entire block
-  block_copy(dest, &ram->blocks[block_address]);
+  ram_unlock(ram);
+}
+
+static void put_u32(unsigned char* out, uint32_t value) {
+  for (int i = 0; i < 4; i++) out[i] = (unsigned char)(value >> (8 * i));
+}
+
+static void put_u64(unsigned char* out, uint64_t value) {
+  for (int i = 0; i < 8; i++) out[i] = (unsigned char)(value >> (8 * i));
+}
+
+static uint32_t get_u32(const unsigned char* in) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; i++) value |= (uint32_t)in[i] << (8 * i);
+  return value;
+}
+
+static uint64_t get_u64(const unsigned char* in) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; i++) value |= (uint64_t)in[i] << (8 * i);
+  return value;
 }
 
-void set_ram_block(RAM* ram, size_t block_address, const Block* src) {
-  if (ram == NULL || src == NULL || block_address >= ram->num_blocks) {
-    return;  // Error
+int ram_load_image(RAM* ram, const char* path) {
+  if (ram == NULL || path == NULL) return -1;
+  if (ram->image_map != NULL || ram->pages.count > 0) return -1;
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return -1;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 ||
+      (size_t)info.st_size < RAM_IMAGE_HEADER_SIZE) {
+    close(fd);
+    return -1;
+  }
+
+  // Read-only: pages are copied before the first store (ram_page_alloc)
+  size_t size = (size_t)info.st_size;
+  void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED) {
+    close(fd);
+    return -1;
+  }
+
+  const unsigned char* header = (const unsigned char*)map;
+  uint64_t words = get_u64(header + 16);
+
+  uint32_t version = get_u32(header + 8);
+
+  // Version 1 has the same words after the header; its block size is ignored
+  if (memcmp(header, RAM_IMAGE_MAGIC, 8) != 0 ||
+      (version != RAM_IMAGE_VERSION && version != RAM_IMAGE_VERSION_BLOCKS) ||
+      (version == RAM_IMAGE_VERSION && get_u32(header + 12) != sizeof(int)) ||
+      (size - RAM_IMAGE_HEADER_SIZE) / sizeof(int) < words) {
+    munmap(map, size);
+    close(fd);
+    return -1;
   }
-    
-  // Copy entire block
-  block_copy(&ram->blocks[block_address], src);
+
+  ram->image_fd = fd;  // Kept to find the holes when saving
+  ram->image_map = map;
+  ram->image_size = size;
+  ram->image = (const int*)((const unsigned char*)map + RAM_IMAGE_HEADER_SIZE);
+  ram->image_words = words;
+
+  if (words > ram->num_words) ram->num_words = words;
+
+  return 0;
+}
+
+static int write_all(int fd, const void* data, size_t bytes, off_t offset) {
+  const char* buffer = (const char*)data;
+  size_t done = 0;
+
+  while (done < bytes) {
+    ssize_t n = pwrite(fd, buffer + done, bytes - done, offset + (off_t)done);
+    if (n <= 0) return -1;
+    done += (size_t)n;
+  }
+
+  return 0;
+}
+
+// Current contents of a touched page, or NULL if it is still the image's
+// (or zeros). `scratch` holds pages that have to be read back from swap.
+static const int* ram_page_contents(RAM* ram, const RAMPage* entry,
+                                    int* scratch) {
+  if (entry->words != NULL) return entry->words;
+  if (!entry->on_disk) return NULL;
+
+  if (swap_io(ram, entry->number_plus_one - 1, scratch, 0) != 0) return NULL;
+  return scratch;
+}
+
+// Copy the untouched pages of the loaded image into `fd`, skipping the
+// holes of a sparse image where the file system can report them
+static int save_image_pages(RAM* ram, int fd) {
+  size_t page_bytes = ram->page_words * sizeof(int);
+  uint64_t image_pages =
+      (ram->image_words + ram->page_words - 1) / ram->page_words;
+  uint64_t page = 0;
+
+  while (page < image_pages) {
+    uint64_t end = image_pages;
+
+#ifdef SEEK_DATA
+    off_t from = RAM_IMAGE_HEADER_SIZE + (off_t)(page * page_bytes);
+    off_t data = lseek(ram->image_fd, from, SEEK_DATA);
+    if (data < 0 && errno == ENXIO) break;  // Only holes left
+    if (data >= 0) {
+      off_t hole = lseek(ram->image_fd, data, SEEK_HOLE);
+      page = (uint64_t)(data - RAM_IMAGE_HEADER_SIZE) / page_bytes;
+      if (hole > data) {
+        uint64_t last = ((uint64_t)(hole - RAM_IMAGE_HEADER_SIZE) +
+                         page_bytes - 1) / page_bytes;
+        if (last < end) end = last;
+      }
+    }
+#endif
+
+    for (; page < end; page++) {
+      if (page_lookup(ram, page, 0) != NULL) continue;
+
+      uint64_t first = page * ram->page_words;
+      if (write_all(fd, &ram->image[first],
+                    image_words_in_page(ram, page) * sizeof(int),
+                    RAM_IMAGE_HEADER_SIZE + (off_t)(first * sizeof(int))) !=
+          0) {
+        return -1;
+      }
+    }
+  }
+
+  return 0;
+}
+
+int ram_save_image(RAM* ram, const char* path) {
+  if (ram == NULL || path == NULL) return -1;
+
+  // Write next to the target and rename, so saving over the loaded image
+  // never changes the pages still mapped from it
+  char temp_path[4096];
+  if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", path) >=
+      (int)sizeof(temp_path)) {
+    return -1;
+  }
+
+  int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return -1;
+
+  // Only the part of the address space holding data goes in the file
+  const RAMPage* pages = (const RAMPage*)ram->pages.entries;
+  uint64_t words = ram->image_words;
+  for (size_t i = 0; i < ram->pages.capacity; i++) {
+    if (pages[i].number_plus_one == 0) continue;
+
+    uint64_t end = pages[i].number_plus_one * ram->page_words;
+    if (end > ram->num_words) end = ram->num_words;
+    if (end > words) words = end;
+  }
+
+  unsigned char header[RAM_IMAGE_HEADER_SIZE] = {0};
+  memcpy(header, RAM_IMAGE_MAGIC, 8);
+  put_u32(header + 8, RAM_IMAGE_VERSION);
+  put_u32(header + 12, sizeof(int));
+  put_u64(header + 16, words);
+
+  // Holes read back as zeros, so untouched pages cost no disk space
+  off_t data_start = RAM_IMAGE_HEADER_SIZE;
+  int status = write_all(fd, header, sizeof(header), 0);
+  if (status == 0 &&
+      ftruncate(fd, data_start + (off_t)(words * sizeof(int))) != 0) {
+    status = -1;
+  }
+
+  // The loaded image first (pages nobody touched), then every touched page
+  if (status == 0) status = save_image_pages(ram, fd);
+
+  int* scratch = (int*)malloc(ram->page_words * sizeof(int));
+  if (scratch == NULL) status = -1;
+
+  for (size_t i = 0; status == 0 && i < ram->pages.capacity; i++) {
+    const RAMPage* entry = &pages[i];
+    if (entry->number_plus_one == 0) continue;
+
+    uint64_t page = entry->number_plus_one - 1;
+    uint64_t first = page * ram->page_words;
+    if (first >= ram->num_words) continue;
+
+    const int* contents = ram_page_contents(ram, entry, scratch);
+    if (contents == NULL) {
+      // Clean and never swapped out: whatever the image holds
+      size_t from_image = image_words_in_page(ram, page);
+      if (from_image == 0) continue;
+      contents = &ram->image[first];
+    }
+
+    uint64_t count = ram->num_words - first;
+    if (count > ram->page_words) count = ram->page_words;
+    status = write_all(fd, contents, (size_t)count * sizeof(int),
+                       data_start + (off_t)(first * sizeof(int)));
+  }
+
+  free(scratch);
+  if (close(fd) != 0) status = -1;
+
+  if (status == 0 && rename(temp_path, path) != 0) status = -1;
+  if (status != 0) unlink(temp_path);
+
+  return status;
 }
 
 void destroy_ram(RAM* ram) {
   if (ram == NULL) return;
-  
-  if (ram->blocks != NULL) {
-    free(ram->blocks);
+
+  // Without swap every page owns its words; with swap they are frames
+  RAMPage* pages = (RAMPage*)ram->pages.entries;
+  if (ram->num_frames == 0 && pages != NULL) {
+    for (size_t i = 0; i < ram->pages.capacity; i++) {
+      if (!pages[i].mapped) free(pages[i].words);
+    }
   }
+  if (ram->image_map != NULL) munmap(ram->image_map, ram->image_size);
+  if (ram->image_fd >= 0) close(ram->image_fd);
+  blockmap_free(&ram->pages);
+  free(ram->frames);
+  free(ram->frame_page);
+  free(ram->frame_used);
+  free(ram->frame_stamp);
+  free(ram->frame_referenced);
+  free(ram->frame_dirty);
+  if (ram->swap_fd >= 0) close(ram->swap_fd);
   free(ram);
-}
\ No newline at end of file
+}
@@ -0,0 +1,201 @@
+#include "include/reuse.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define REUSE_INITIAL_TABLE 1024
+#define REUSE_INITIAL_TIME (1 << 16)
+
+static void fenwick_add(int* tree, size_t capacity, size_t position,
+                        int delta) {
+  for (size_t i = position + 1; i <= capacity; i += i & (~i + 1)) {
+    tree[i - 1] += delta;
+  }
+}
+
+// Marks at positions 0..position
+static int fenwick_prefix(const int* tree, size_t position) {
+  int sum = 0;
+  for (size_t i = position + 1; i > 0; i -= i & (~i + 1)) {
+    sum += tree[i - 1];
+  }
+  return sum;
+}
+
+static int reuse_compare_time(const void* a, const void* b) {
+  size_t ta = (*(ReuseEntry* const*)a)->time;
+  size_t tb = (*(ReuseEntry* const*)b)->time;
+  return (ta > tb) - (ta < tb);
+}
+
+// Renumber the live blocks 0..count-1 keeping their order, so the tree
+// only has to cover the blocks in use and not the whole run
+static int reuse_compact(ReuseAnalyzer* reuse) {
+  ReuseEntry** live =
+      (ReuseEntry**)malloc((reuse->table.count + 1) * sizeof(ReuseEntry*));
+  if (live == NULL) return -1;
+
+  ReuseEntry* entries = (ReuseEntry*)reuse->table.entries;
+  size_t count = 0;
+  for (size_t i = 0; i < reuse->table.capacity; i++) {
+    if (entries[i].block_plus_one != 0) live[count++] = &entries[i];
+  }
+  qsort(live, count, sizeof(ReuseEntry*), reuse_compare_time);
+
+  size_t capacity = REUSE_INITIAL_TIME;
+  while (capacity < 2 * count) capacity *= 2;
+
+  int* tree = (int*)calloc(capacity, sizeof(int));
+  if (tree == NULL) {
+    free(live);
+    return -1;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    live[i]->time = i;
+    fenwick_add(tree, capacity, i, 1);
+  }
+
+  free(live);
+  free(reuse->tree);
+  reuse->tree = tree;
+  reuse->tree_capacity = capacity;
+  reuse->time = count;
+  return 0;
+}
+
+ReuseAnalyzer* reuse_create(int max_distance) {
+  if (max_distance < 1) return NULL;
+
+  ReuseAnalyzer* reuse = (ReuseAnalyzer*)calloc(1, sizeof(ReuseAnalyzer));
+  if (reuse == NULL) return NULL;
+
+  int status = blockmap_init(&reuse->table, sizeof(ReuseEntry),
+                             REUSE_INITIAL_TABLE);
+  reuse->tree_capacity = REUSE_INITIAL_TIME;
+  reuse->tree = (int*)calloc(reuse->tree_capacity, sizeof(int));
+  reuse->max_distance = max_distance;
+  reuse->histogram = (uint64_t*)calloc(max_distance, sizeof(uint64_t));
+
+  if (status != 0 || reuse->tree == NULL || reuse->histogram == NULL) {
+    reuse_destroy(reuse);
+    return NULL;
+  }
+
+  return reuse;
+}
+
+void reuse_destroy(ReuseAnalyzer* reuse) {
+  if (reuse == NULL) return;
+
+  blockmap_free(&reuse->table);
+  free(reuse->tree);
+  free(reuse->histogram);
+  free(reuse);
+}
+
+void reuse_record(ReuseAnalyzer* reuse, uint64_t block_address) {
+  if (reuse == NULL || reuse->failed) return;
+
+  if (reuse->time == reuse->tree_capacity && reuse_compact(reuse) != 0) {
+    reuse->failed = 1;
+    return;
+  }
+
+  int first;
+  ReuseEntry* entry =
+      (ReuseEntry*)blockmap_insert(&reuse->table, block_address, &first);
+  if (entry == NULL) {
+    reuse->failed = 1;
+    return;
+  }
+
+  reuse->accesses++;
+
+  if (first) {
+    reuse->cold++;
+  } else {
+    // Blocks touched since the last access to this one
+    size_t distance = reuse->table.count -
+                      (size_t)fenwick_prefix(reuse->tree, entry->time);
+    if (distance < (size_t)reuse->max_distance) {
+      reuse->histogram[distance]++;
+    } else {
+      reuse->beyond++;
+    }
+    fenwick_add(reuse->tree, reuse->tree_capacity, entry->time, -1);
+  }
+
+  entry->time = reuse->time++;
+  fenwick_add(reuse->tree, reuse->tree_capacity, entry->time, 1);
+}
+
+double reuse_miss_ratio(const ReuseAnalyzer* reuse, int lines) {
+  if (reuse == NULL || reuse->accesses == 0) return 0.0;
+  if (lines < 0) lines = 0;
+  if (lines > reuse->max_distance) lines = reuse->max_distance;
+
+  uint64_t misses = reuse->cold + reuse->beyond;
+  for (int d = lines; d < reuse->max_distance; d++) {
+    misses += reuse->histogram[d];
+  }
+
+  return (double)misses / (double)reuse->accesses;
+}
+
+void reuse_print_curve(const ReuseAnalyzer* reuse, FILE* out, int max_lines) {
+  if (reuse == NULL) return;
+  if (max_lines > reuse->max_distance) max_lines = reuse->max_distance;
+
+  fprintf(out, "\n=== MISS RATIO CURVE (fully associative LRU) ===\n");
+  fprintf(out, "Accesses: %llu, distinct blocks: %llu, cold misses: %llu\n",
+          (unsigned long long)reuse->accesses,
+          (unsigned long long)reuse->table.count,
+          (unsigned long long)reuse->cold);
+  if (reuse->failed) {
+    fprintf(out, "Incomplete: out of memory, only the first %llu accesses "
+                 "are counted\n",
+            (unsigned long long)reuse->accesses);
+  }
+  fprintf(out, "  Lines | Miss Rate | Hit Rate\n");
+  fprintf(out, "--------|-----------|----------\n");
+
+  // Walk the sizes upwards, taking each distance out of the misses once
+  uint64_t misses = reuse->accesses;
+  for (int lines = 1; lines <= max_lines; lines++) {
+    misses -= reuse->histogram[lines - 1];
+    double rate = (reuse->accesses > 0)
+                      ? (double)misses * 100.0 / (double)reuse->accesses
+                      : 0.0;
+    fprintf(out, "%7d | %8.2f%% | %7.2f%%\n", lines, rate, 100.0 - rate);
+  }
+}
+
+void reuse_print_levels(const ReuseAnalyzer* reuse, FILE* out,
+                        const UCM* ucm) {
+  if (reuse == NULL || ucm == NULL) return;
+
+  if (reuse->failed) {
+    fprintf(out, "\nPredictions come from the incomplete curve above\n");
+  }
+  fprintf(out, "\n  Level | Lines | Predicted Hit Rate | Measured Hit Rate\n");
+  fprintf(out, "--------|-------|--------------------|------------------\n");
+
+  // Accesses reaching a level are the ones every level above missed
+  double reaching = 1.0;
+  for (int level = 0; level < ucm->num_levels; level++) {
+    const Cache* cache = ucm->levels[level];
+    double missing = reuse_miss_ratio(reuse, cache->num_lines);
+    if (missing > reaching) missing = reaching;
+
+    double predicted =
+        (reaching > 0.0) ? (reaching - missing) * 100.0 / reaching : 0.0;
+    int looked_up = cache->hits + cache->misses;
+    double measured =
+        (looked_up > 0) ? (double)cache->hits * 100.0 / looked_up : 0.0;
+
+    fprintf(out, "     L%d | %5d | %17.2f%% | %16.2f%%\n", level + 1,
+            cache->num_lines, predicted, measured);
+    reaching = missing;
+  }
+}
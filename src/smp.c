@@ -0,0 +1,683 @@
+#include "include/smp.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+SmpSystem* smp_create(RAM* ram, const UCMConfig* config, int num_cores) {
+  if (ram == NULL || config == NULL || ram->lock != NULL) return NULL;
+  if (num_cores < 1 || num_cores > SMP_MAX_CORES) return NULL;
+
+  // At least one private level over the shared one
+  if (config->num_levels < 2 || config->num_levels > UCM_MAX_LEVELS) {
+    return NULL;
+  }
+
+  // Parts of the single-core model the protocol does not cover
+  if (config->fetch || config->victim_lines > 0 ||
+      config->prefetch != PREFETCH_NONE || config->mshrs[0] > 0) {
+    return NULL;
+  }
+  if (config->latency[config->num_levels - 1] < 0) return NULL;
+
+  SmpSystem* smp = (SmpSystem*)calloc(1, sizeof(SmpSystem));
+  if (smp == NULL) return NULL;
+
+  if (block_shape_init(&smp->block, config->block_words) != 0) {
+    free(smp);
+    return NULL;
+  }
+
+  int last = config->num_levels - 1;
+  smp->shared = cache_create_assoc(config->lines[last],
+                                   config->associativity[last],
+                                   config->block_words, config->latency[last]);
+  if (smp->shared == NULL) {
+    free(smp);
+    return NULL;
+  }
+
+  smp->private_levels = last;
+  smp->ram = ram;
+  smp->ram_latency = config->ram_latency;
+  smp->disk_latency = config->disk_latency;
+  smp->threads = 1;
+  pthread_mutex_init(&smp->bus, NULL);
+  pthread_mutex_init(&smp->ram_lock, NULL);
+
+  // Each core is a UCM holding only the private levels
+  UCMConfig private_config = *config;
+  private_config.num_levels = last;
+  private_config.write_policy = UCM_WRITE_BACK;
+  private_config.allocate_policy = UCM_WRITE_ALLOCATE;
+  private_config.inclusion = UCM_INCLUSIVE;
+  private_config.classify_misses = 0;
+
+  for (int i = 0; i < num_cores; i++) {
+    SmpCore* core = &smp->cores[i];
+    core->ucm = ucm_create_with_config(ram, &private_config);
+    if (core->ucm == NULL) {
+      smp_destroy(smp);
+      return NULL;
+    }
+
+    pthread_mutex_init(&core->lock, NULL);
+    core->ucm->smp = smp;
+    core->ucm->core = i;
+    smp->num_cores++;
+  }
+
+  // Programs write RAM directly too, from every core's thread
+  ram->lock = &smp->ram_lock;
+  return smp;
+}
+
+void smp_destroy(SmpSystem* smp) {
+  if (smp == NULL) return;
+
+  smp_flush(smp);
+
+  for (int i = 0; i < smp->num_cores; i++) {
+    SmpCore* core = &smp->cores[i];
+    core->ucm->smp = NULL;  // Clean by now; nothing left to flush
+    ucm_destroy(core->ucm);
+    pthread_mutex_destroy(&core->lock);
+  }
+  cache_destroy(smp->shared);
+
+  if (smp->ram->lock == &smp->ram_lock) smp->ram->lock = NULL;
+  pthread_mutex_destroy(&smp->bus);
+  pthread_mutex_destroy(&smp->ram_lock);
+  free(smp);
+}
+
+static void smp_ram_read(SmpSystem* smp, uint64_t block_address, int* dest) {
+  get_ram_words(smp->ram, block_to_word(&smp->block, block_address), dest,
+                (size_t)smp->block.words);
+}
+
+static void smp_ram_write(SmpSystem* smp, uint64_t block_address,
+                          const int* src) {
+  set_ram_words(smp->ram, block_to_word(&smp->block, block_address), src,
+                (size_t)smp->block.words);
+}
+
+// The swap counters change under ram->lock (programs write RAM directly)
+static uint64_t smp_disk_operations(SmpSystem* smp) {
+  pthread_mutex_lock(&smp->ram_lock);
+  uint64_t operations = ram_disk_operations(smp->ram);
+  pthread_mutex_unlock(&smp->ram_lock);
+  return operations;
+}
+
+// Topmost private copy of a block, which is the newest one (NULL if the
+// core does not hold it); *level gets where it was found
+static CacheLine* smp_find_private(UCM* ucm, uint64_t block_address,
+                                   int* level) {
+  for (int i = 0; i < ucm->num_levels; i++) {
+    CacheLine* line = cache_probe(ucm->levels[i], block_address);
+    if (line != NULL) {
+      *level = i;
+      return line;
+    }
+  }
+  return NULL;
+}
+
+static void smp_set_state(UCM* ucm, uint64_t block_address,
+                          CacheState state) {
+  for (int i = 0; i < ucm->num_levels; i++) {
+    CacheLine* line = cache_probe(ucm->levels[i], block_address);
+    if (line != NULL) line->state = state;
+  }
+}
+
+// After the newest data went below the private levels: every copy gets it,
+// clean, in `state`. Returns the topmost copy.
+static CacheLine* smp_clean_private(UCM* ucm, uint64_t block_address,
+                                    CacheState state) {
+  CacheLine* newest = NULL;
+  for (int i = 0; i < ucm->num_levels; i++) {
+    CacheLine* line = cache_probe(ucm->levels[i], block_address);
+    if (line == NULL) continue;
+
+    if (newest == NULL) {
+      newest = line;
+    } else {
+      block_copy(line->data, newest->data, ucm->block.words);
+    }
+    line->dirty = 0;
+    line->state = state;
+  }
+  return newest;
+}
+
+// Drop every private copy of a block, handing the newest data to `data`
+// (if not NULL)
+static void smp_invalidate_private(UCM* ucm, uint64_t block_address,
+                                   int* data) {
+  for (int i = 0; i < ucm->num_levels; i++) {
+    Cache* cache = ucm->levels[i];
+    CacheLine* line = cache_probe(cache, block_address);
+    if (line == NULL) continue;
+
+    if (data != NULL) {
+      block_copy(data, line->data, ucm->block.words);
+      data = NULL;  // The topmost copy is the newest
+    }
+    cache_invalidate(cache, line);
+  }
+}
+
+// A block leaving the private levels: into the shared level if it still
+// has the block, else into RAM. Returns the latency charged.
+static int smp_write_shared(SmpSystem* smp, uint64_t block_address,
+                            const int* data) {
+  CacheLine* line = cache_probe(smp->shared, block_address);
+  if (line != NULL) {
+    block_copy(line->data, data, smp->block.words);
+    line->dirty = 1;
+    return smp->shared->access_time;
+  }
+
+  smp_ram_write(smp, block_address, data);
+  return smp->ram_latency;
+}
+
+// `victim` just left `level` of a core. Inclusion: its copies above go
+// too, and the newest data, if dirty anywhere, goes one level down (the
+// next private level always holds the block; below the last one is the
+// shared level, so only that case needs the bus).
+static void smp_evicted(SmpSystem* smp, UCM* ucm, int level,
+                        CacheLine* victim, int* access_time) {
+  int dirty = victim->dirty;
+  int newest_found = 0;
+  for (int above = 0; above < level; above++) {
+    Cache* cache = ucm->levels[above];
+    CacheLine* copy = cache_probe(cache, victim->tag);
+    if (copy == NULL) continue;
+
+    if (!newest_found) {
+      block_copy(victim->data, copy->data, ucm->block.words);
+      newest_found = 1;
+    }
+    dirty |= copy->dirty;
+    cache_invalidate(cache, copy);
+    ucm->back_invalidations++;
+  }
+  if (!dirty) return;
+
+  if (!victim->dirty) ucm->levels[level]->writebacks++;
+  if (level + 1 < ucm->num_levels) {
+    Cache* below = ucm->levels[level + 1];
+    CacheLine* line = cache_probe(below, victim->tag);
+    if (line != NULL) {
+      block_copy(line->data, victim->data, ucm->block.words);
+      line->dirty = 1;
+      *access_time += below->access_time;
+    }
+  } else {
+    *access_time += smp_write_shared(smp, victim->tag, victim->data);
+  }
+}
+
+// Load a block into private levels [from, to], deepest first, in `state`.
+// Returns the copy at `from`.
+static CacheLine* smp_fill_private(SmpSystem* smp, UCM* ucm, int from, int to,
+                                   uint64_t block_address, const int* data,
+                                   CacheState state, int* access_time) {
+  int buffer[BLOCK_MAX_WORDS];
+  CacheLine victim;
+  victim.data = buffer;
+
+  CacheLine* line = NULL;
+  for (int level = to; level >= from; level--) {
+    line = cache_load(ucm->levels[level], block_address, data, &victim);
+    line->state = state;
+    if (victim.valid) smp_evicted(smp, ucm, level, &victim, access_time);
+  }
+  return line;
+}
+
+// A private hit (with the permission it needs): counts it, brings the
+// block up to L1 and does the read or write there
+static int smp_private_hit(SmpSystem* smp, UCM* ucm, int level,
+                           CacheLine* line, int word_offset,
+                           UCM_Operation operation, int value,
+                           int* access_time) {
+  for (int i = 0; i < level; i++) {
+    ucm->levels[i]->misses++;
+    *access_time += ucm->levels[i]->access_time;
+  }
+  ucm->levels[level]->hits++;
+  *access_time += ucm->levels[level]->access_time;
+  cache_touch(ucm->levels[level], line);
+
+  ucm->total_hits++;
+  ucm->source = level;
+  if (level > 0) {
+    // Copy first: filling the levels above reuses the buffer of victims
+    int data[BLOCK_MAX_WORDS];
+    block_copy(data, line->data, ucm->block.words);
+    line = smp_fill_private(smp, ucm, 0, level - 1, line->tag, data,
+                            line->state, access_time);
+  }
+
+  if (operation != UCM_WRITE) return line->data[word_offset];
+
+  if (level > 0) {
+    ucm->write_misses++;
+    ucm->write_allocates++;
+  }
+  if (line->state != CACHE_MODIFIED) {
+    smp_set_state(ucm, line->tag, CACHE_MODIFIED);  // E -> M, silently
+  }
+  line->data[word_offset] = value;
+  line->dirty = 1;
+  return 0;
+}
+
+// The other cores' answer to a request for a block: `exclusive` (a store)
+// invalidates their copies, a read leaves them in S. A core holding it in
+// M or E hands the data over (*supplied); M also writes it below first
+// when it keeps a copy.
+static void smp_snoop(SmpSystem* smp, int requester, uint64_t block_address,
+                      int exclusive, int* data, int* supplied,
+                      int* sharers) {
+  SmpCore* self = &smp->cores[requester];
+
+  for (int i = 0; i < smp->num_cores; i++) {
+    if (i == requester) continue;
+
+    SmpCore* other = &smp->cores[i];
+    pthread_mutex_lock(&other->lock);
+
+    int level;
+    CacheLine* line = smp_find_private(other->ucm, block_address, &level);
+    if (line != NULL) {
+      int owner = (line->state == CACHE_MODIFIED ||
+                   line->state == CACHE_EXCLUSIVE);
+      if (exclusive) {
+        smp_invalidate_private(other->ucm, block_address,
+                               (owner && data != NULL) ? data : NULL);
+        self->invalidations++;
+      } else {
+        if (line->state == CACHE_MODIFIED) {
+          smp_write_shared(smp, block_address, line->data);
+        }
+        line = smp_clean_private(other->ucm, block_address, CACHE_SHARED);
+        if (owner && data != NULL) {
+          block_copy(data, line->data, smp->block.words);
+        }
+        *sharers = 1;
+      }
+      if (owner && data != NULL) *supplied = 1;
+    }
+
+    pthread_mutex_unlock(&other->lock);
+  }
+}
+
+// An access that needs the bus: a private miss or a store to a shared
+// copy. Called with smp->bus held, which is enough for the core's own
+// caches: other threads only reach them through snoops and flushes, and
+// those take the bus too. So at most one core lock is held at a time.
+static int smp_access_bus(SmpSystem* smp, int core, uint64_t block_address,
+                          int word_offset, UCM_Operation operation,
+                          int value, int* access_time) {
+  SmpCore* self = &smp->cores[core];
+  UCM* ucm = self->ucm;
+  int write = (operation == UCM_WRITE);
+
+  // Look again: a snoop may have taken the block since the first try
+  int level;
+  CacheLine* line = smp_find_private(ucm, block_address, &level);
+  if (line != NULL) {
+    if (write && line->state == CACHE_SHARED) {
+      smp_snoop(smp, core, block_address, 1, NULL, NULL, NULL);
+      self->upgrades++;
+      *access_time += smp->shared->access_time;
+    }
+    return smp_private_hit(smp, ucm, level, line, word_offset, operation,
+                           value, access_time);
+  }
+
+  for (int i = 0; i < ucm->num_levels; i++) {
+    ucm->levels[i]->misses++;
+    *access_time += ucm->levels[i]->access_time;
+  }
+  *access_time += smp->shared->access_time;  // The snoop goes alongside
+
+  int data[BLOCK_MAX_WORDS];
+  int supplied = 0;
+  int sharers = 0;
+  smp_snoop(smp, core, block_address, write, data, &supplied, &sharers);
+
+  ucm->source = ucm->num_levels;  // The shared level's index
+  if (supplied) {
+    self->transfers++;
+    ucm->total_hits++;
+  } else {
+    CacheLine* shared_line = cache_probe(smp->shared, block_address);
+    if (shared_line != NULL) {
+      smp->shared->hits++;
+      self->shared_hits++;
+      ucm->total_hits++;
+      cache_touch(smp->shared, shared_line);
+      block_copy(data, shared_line->data, smp->block.words);
+    } else {
+      smp->shared->misses++;
+      self->shared_misses++;
+      ucm->total_misses++;
+      ucm->source = UCM_SOURCE_RAM;
+      smp_ram_read(smp, block_address, data);
+      *access_time += smp->ram_latency;
+
+      int buffer[BLOCK_MAX_WORDS];
+      CacheLine victim;
+      victim.data = buffer;
+      cache_load(smp->shared, block_address, data, &victim);
+      if (victim.valid && victim.dirty) {
+        smp_ram_write(smp, victim.tag, victim.data);
+        self->shared_writebacks++;
+        *access_time += smp->ram_latency;
+      }
+    }
+  }
+
+  CacheState state = write      ? CACHE_MODIFIED
+                     : sharers  ? CACHE_SHARED
+                                : CACHE_EXCLUSIVE;
+  line = smp_fill_private(smp, ucm, 0, ucm->num_levels - 1, block_address,
+                          data, state, access_time);
+
+  if (!write) return line->data[word_offset];
+
+  ucm->write_misses++;
+  ucm->write_allocates++;
+  line->data[word_offset] = value;
+  line->dirty = 1;
+  return 0;
+}
+
+int smp_access(SmpSystem* smp, int core, uint64_t address,
+               UCM_Operation operation, int value) {
+  if (smp == NULL || core < 0 || core >= smp->num_cores) return 0;
+
+  SmpCore* self = &smp->cores[core];
+  UCM* ucm = self->ucm;
+  uint64_t block_address = word_to_block(&smp->block, address);
+  int word_offset = word_to_offset(&smp->block, address);
+  int access_time = 0;
+  int result = 0;
+
+  // Private hits that need no other core take only the core's lock
+  pthread_mutex_lock(&self->lock);
+  int level;
+  CacheLine* line = smp_find_private(ucm, block_address, &level);
+  int local = (line != NULL && (operation != UCM_WRITE ||
+                                line->state != CACHE_SHARED));
+  if (local) {
+    result = smp_private_hit(smp, ucm, level, line, word_offset, operation,
+                             value, &access_time);
+  }
+  pthread_mutex_unlock(&self->lock);
+
+  uint64_t disk_operations = 0;
+  if (!local) {
+    pthread_mutex_lock(&smp->bus);
+    uint64_t disk_before = smp_disk_operations(smp);
+    result = smp_access_bus(smp, core, block_address, word_offset, operation,
+                            value, &access_time);
+    disk_operations = smp_disk_operations(smp) - disk_before;
+    pthread_mutex_unlock(&smp->bus);
+  }
+
+  // Only this core's thread touches its counters
+  ucm->total_accesses++;
+  if (operation == UCM_WRITE) ucm->write_accesses++;
+  ucm->total_time += (uint64_t)access_time;
+  if (disk_operations > 0) {
+    ucm->disk_accesses++;
+    ucm->total_time += disk_operations * (uint64_t)smp->disk_latency;
+  }
+  return result;
+}
+
+void smp_flush(SmpSystem* smp) {
+  if (smp == NULL) return;
+
+  pthread_mutex_lock(&smp->bus);
+
+  for (int i = 0; i < smp->num_cores; i++) {
+    SmpCore* core = &smp->cores[i];
+    UCM* ucm = core->ucm;
+    pthread_mutex_lock(&core->lock);
+
+    for (int level = 0; level < ucm->num_levels; level++) {
+      Cache* cache = ucm->levels[level];
+      for (int l = 0; l < cache->num_lines; l++) {
+        CacheLine* line = &cache->lines[l];
+        if (!line->valid || line->state != CACHE_MODIFIED) continue;
+
+        // Only the topmost copy is the newest
+        int found;
+        CacheLine* newest = smp_find_private(ucm, line->tag, &found);
+        if (newest != line) continue;
+
+        smp_write_shared(smp, line->tag, line->data);
+        smp_clean_private(ucm, line->tag, CACHE_EXCLUSIVE);
+      }
+    }
+
+    pthread_mutex_unlock(&core->lock);
+  }
+
+  for (int l = 0; l < smp->shared->num_lines; l++) {
+    CacheLine* line = &smp->shared->lines[l];
+    if (line->valid && line->dirty) {
+      smp_ram_write(smp, line->tag, line->data);
+      line->dirty = 0;
+    }
+  }
+
+  pthread_mutex_unlock(&smp->bus);
+}
+
+void smp_reset_core_stats(SmpSystem* smp, int core) {
+  if (smp == NULL || core < 0 || core >= smp->num_cores) return;
+
+  SmpCore* self = &smp->cores[core];
+  self->shared_hits = 0;
+  self->shared_misses = 0;
+  self->shared_writebacks = 0;
+  self->invalidations = 0;
+  self->upgrades = 0;
+  self->transfers = 0;
+}
+
+// Shared by every worker; only `next` is written concurrently
+typedef struct SmpJob {
+  SmpSystem* smp;
+  const ProgramInfo* program;
+  int arg1;
+  int arg2;
+  const TraceReader* trace;
+  atomic_int next;
+} SmpJob;
+
+static void* smp_worker(void* arg) {
+  SmpJob* job = (SmpJob*)arg;
+
+  for (;;) {
+    int index = atomic_fetch_add(&job->next, 1);
+    if (index >= job->smp->num_cores) break;
+
+    SmpCore* core = &job->smp->cores[index];
+    if (job->trace != NULL) {
+      trace_replay(job->trace, core->ucm);
+    } else {
+      job->program->run(core->ucm, &core->reg, job->arg1, job->arg2);
+    }
+  }
+
+  return NULL;
+}
+
+void smp_run(SmpSystem* smp, const ProgramInfo* program, int arg1, int arg2,
+             const TraceReader* trace, int threads) {
+  if (smp == NULL || (program == NULL && trace == NULL)) return;
+
+  SmpJob job;
+  job.smp = smp;
+  job.program = program;
+  job.arg1 = arg1;
+  job.arg2 = arg2;
+  job.trace = trace;
+  atomic_init(&job.next, 0);
+
+  if (threads <= 0 || threads > smp->num_cores) threads = smp->num_cores;
+
+  // Programs would interleave their output across cores
+  program_set_verbose(0);
+
+  pthread_t workers[SMP_MAX_CORES];
+  int started = 0;
+  for (int i = 0; threads > 1 && i < threads; i++) {
+    if (pthread_create(&workers[i], NULL, smp_worker, &job) != 0) break;
+    started++;
+  }
+
+  // One thread (or none could start): the cores run in order, here
+  if (started == 0) smp_worker(&job);
+
+  for (int i = 0; i < started; i++) {
+    pthread_join(workers[i], NULL);
+  }
+  smp->threads = (started > 0) ? started : 1;
+
+  program_set_verbose(1);
+}
+
+void smp_get_stats(SmpSystem* smp, int core, UCMStats* stats) {
+  if (smp == NULL || core < 0 || core >= smp->num_cores || stats == NULL) {
+    return;
+  }
+
+  SmpCore* self = &smp->cores[core];
+  ucm_get_stats(self->ucm, stats);
+
+  // The shared level, as this core saw it
+  CacheStats* shared = &stats->levels[stats->num_levels++];
+  memset(shared, 0, sizeof(CacheStats));
+  shared->lines = smp->shared->num_lines;
+  shared->associativity = smp->shared->associativity;
+  shared->latency = smp->shared->access_time;
+  shared->hits = self->shared_hits;
+  shared->misses = self->shared_misses;
+  shared->writebacks = self->shared_writebacks;
+
+  stats->invalidations = self->invalidations;
+  stats->upgrades = self->upgrades;
+  stats->transfers = self->transfers;
+}
+
+void smp_print_stats(SmpSystem* smp) {
+  if (smp == NULL) return;
+
+  int shared_level = smp->private_levels + 1;
+  int invalidations = 0;
+  int upgrades = 0;
+  int transfers = 0;
+  int disk_accesses = 0;
+  uint64_t total_time = 0;
+  uint64_t parallel_time = 0;
+
+  printf("\n");
+  printf("╔════════════════════════════════════════════════╗\n");
+  printf("║             MULTI-CORE STATISTICS              ║\n");
+  printf("╠════════════════════════════════════════════════╣\n");
+  printf("║ Cores: %3d   Host Threads: %3d                 ║\n",
+         smp->num_cores, smp->threads);
+  printf("║ Private: L1-L%d   Shared: L%d (%6d lines)     ║\n",
+         smp->private_levels, shared_level, smp->shared->num_lines);
+  printf("║ Coherence: MESI (write-back private caches)    ║\n");
+  printf("╠════════════════════════════════════════════════╣\n");
+
+  for (int i = 0; i < smp->num_cores; i++) {
+    SmpCore* core = &smp->cores[i];
+    UCM* ucm = core->ucm;
+
+    printf("║ Core %2d:                                       ║\n", i);
+    printf("║   Accesses: %8d   Hit Rate: %6.2f%%       ║\n",
+           ucm->total_accesses, ucm_get_hit_rate(ucm) * 100.0);
+    for (int level = 0; level < ucm->num_levels; level++) {
+      printf("║   L%d  Hits: %8d   Misses: %8d        ║\n", level + 1,
+             ucm->levels[level]->hits, ucm->levels[level]->misses);
+    }
+    printf("║   L%d  Hits: %8d   Misses: %8d        ║\n", shared_level,
+           core->shared_hits, core->shared_misses);
+    printf("║   Invalidations: %6d   Upgrades: %6d     ║\n",
+           core->invalidations, core->upgrades);
+    printf("║   Cache-to-Cache Transfers: %6d             ║\n",
+           core->transfers);
+    printf("║   Time (cycles): %10llu                    ║\n",
+           (unsigned long long)ucm->total_time);
+    printf("╠════════════════════════════════════════════════╣\n");
+
+    invalidations += core->invalidations;
+    upgrades += core->upgrades;
+    transfers += core->transfers;
+    disk_accesses += ucm->disk_accesses;
+    total_time += ucm->total_time;
+    if (ucm->total_time > parallel_time) parallel_time = ucm->total_time;
+  }
+
+  printf("║ Shared L%d: Hits: %8d   Misses: %8d   ║\n", shared_level,
+         smp->shared->hits, smp->shared->misses);
+  printf("║   Writebacks to RAM: %8d                  ║\n",
+         smp->shared->writebacks);
+  if (smp->ram->num_frames > 0) {
+    printf("║ Disk Accesses:         %6d                  ║\n",
+           disk_accesses);
+  }
+  printf("║ Invalidations: %8d   Upgrades: %8d   ║\n", invalidations,
+         upgrades);
+  printf("║ Cache-to-Cache Transfers: %8d             ║\n", transfers);
+  printf("║ Time, slowest core (cycles): %10llu        ║\n",
+         (unsigned long long)parallel_time);
+  printf("║ Time, all cores (cycles):    %10llu        ║\n",
+         (unsigned long long)total_time);
+  printf("╚════════════════════════════════════════════════╝\n");
+  printf("\n");
+}
+
+void smp_print_stats_format(SmpSystem* smp, FILE* out, StatsFormat format) {
+  if (smp == NULL) return;
+
+  if (format == STATS_BOX) {
+    smp_print_stats(smp);
+    return;
+  }
+
+  int levels = smp->private_levels + 1;
+  if (format == STATS_CSV) {
+    stats_print_csv_header(out, levels);
+  } else {
+    fprintf(out, "[\n");
+  }
+
+  for (int i = 0; i < smp->num_cores; i++) {
+    UCMStats stats;
+    smp_get_stats(smp, i, &stats);
+
+    if (format == STATS_CSV) {
+      stats_print_csv_row(out, &stats, levels);
+    } else {
+      if (i > 0) fprintf(out, ",\n");
+      stats_print_json(out, &stats);
+    }
+  }
+
+  if (format != STATS_CSV) fprintf(out, "\n]\n");
+}
@@ -0,0 +1,206 @@
+#include "include/stats.h"
+
+#include <stddef.h>
+#include <string.h>
+
+typedef enum {
+  STATS_INT,
+  STATS_U64,
+  STATS_DOUBLE,
+  STATS_STRING
+} StatsType;
+
+// One counter: its name in the output and where it lives in the struct
+typedef struct StatsField {
+  const char* name;
+  StatsType type;
+  size_t offset;
+} StatsField;
+
+#define STATS_FIELD(name, type, member) \
+  { name, type, offsetof(UCMStats, member) }
+#define CACHE_FIELD(name, type, member) \
+  { name, type, offsetof(CacheStats, member) }
+
+static const StatsField stats_fields[] = {
+    STATS_FIELD("levels", STATS_INT, num_levels),
+    STATS_FIELD("accesses", STATS_INT, total_accesses),
+    STATS_FIELD("hits", STATS_INT, total_hits),
+    STATS_FIELD("misses", STATS_INT, total_misses),
+    STATS_FIELD("hit_rate", STATS_DOUBLE, hit_rate),
+    STATS_FIELD("time", STATS_U64, total_time),
+    STATS_FIELD("amat", STATS_DOUBLE, amat),
+    STATS_FIELD("disk_accesses", STATS_INT, disk_accesses),
+    STATS_FIELD("page_faults", STATS_U64, page_faults),
+    STATS_FIELD("disk_reads", STATS_U64, disk_reads),
+    STATS_FIELD("disk_writes", STATS_U64, disk_writes),
+    STATS_FIELD("writes", STATS_INT, write_accesses),
+    STATS_FIELD("write_misses", STATS_INT, write_misses),
+    STATS_FIELD("write_allocates", STATS_INT, write_allocates),
+    STATS_FIELD("write_arounds", STATS_INT, write_arounds),
+    STATS_FIELD("back_invalidations", STATS_INT, back_invalidations),
+    STATS_FIELD("unique_blocks", STATS_INT, unique_blocks),
+    STATS_FIELD("cached_lines", STATS_INT, cached_lines),
+    STATS_FIELD("fetches", STATS_INT, fetch_accesses),
+    STATS_FIELD("fetch_hits", STATS_INT, fetch_hits),
+    STATS_FIELD("fetch_misses", STATS_INT, fetch_misses),
+    STATS_FIELD("fetch_time", STATS_U64, fetch_time),
+    STATS_FIELD("fetch_amat", STATS_DOUBLE, fetch_amat),
+    STATS_FIELD("mshr_merges", STATS_INT, mshr_merges),
+    STATS_FIELD("mshr_stalls", STATS_INT, mshr_stalls),
+    STATS_FIELD("mlp", STATS_DOUBLE, mlp),
+    STATS_FIELD("invalidations", STATS_INT, invalidations),
+    STATS_FIELD("upgrades", STATS_INT, upgrades),
+    STATS_FIELD("transfers", STATS_INT, transfers),
+    STATS_FIELD("prefetch_issued", STATS_INT, prefetch_issued),
+    STATS_FIELD("prefetch_useful", STATS_INT, prefetch_useful),
+    STATS_FIELD("prefetch_late", STATS_INT, prefetch_late),
+    STATS_FIELD("prefetch_polluting", STATS_INT, prefetch_polluting),
+    STATS_FIELD("write_policy", STATS_STRING, write_policy),
+    STATS_FIELD("allocate_policy", STATS_STRING, allocate_policy),
+    STATS_FIELD("inclusion", STATS_STRING, inclusion),
+};
+
+// The last three are left empty (null) when the cache is not classified
+static const StatsField cache_fields[] = {
+    CACHE_FIELD("lines", STATS_INT, lines),
+    CACHE_FIELD("assoc", STATS_INT, associativity),
+    CACHE_FIELD("latency", STATS_INT, latency),
+    CACHE_FIELD("hits", STATS_INT, hits),
+    CACHE_FIELD("misses", STATS_INT, misses),
+    CACHE_FIELD("writebacks", STATS_INT, writebacks),
+    CACHE_FIELD("compulsory", STATS_INT, compulsory),
+    CACHE_FIELD("capacity", STATS_INT, capacity),
+    CACHE_FIELD("conflict", STATS_INT, conflict),
+};
+
+#define STATS_NUM_FIELDS (sizeof(stats_fields) / sizeof(stats_fields[0]))
+#define CACHE_NUM_FIELDS (sizeof(cache_fields) / sizeof(cache_fields[0]))
+#define CACHE_CLASS_FIELDS 3
+
+int stats_parse_format(const char* name, StatsFormat* format) {
+  if (strcmp(name, "box") == 0) {
+    *format = STATS_BOX;
+  } else if (strcmp(name, "json") == 0) {
+    *format = STATS_JSON;
+  } else if (strcmp(name, "csv") == 0) {
+    *format = STATS_CSV;
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+static void stats_print_value(FILE* out, const StatsField* field,
+                              const void* base, int quote) {
+  const char* at = (const char*)base + field->offset;
+
+  switch (field->type) {
+    case STATS_INT:
+      fprintf(out, "%d", *(const int*)at);
+      break;
+    case STATS_U64:
+      fprintf(out, "%llu", (unsigned long long)*(const uint64_t*)at);
+      break;
+    case STATS_DOUBLE:
+      fprintf(out, "%.6f", *(const double*)at);
+      break;
+    case STATS_STRING:
+      fprintf(out, quote ? "\"%s\"" : "%s", *(const char* const*)at);
+      break;
+  }
+}
+
+// A cache's fields, without the 3C ones when it was not classified
+static int stats_cache_fields(const CacheStats* cache) {
+  return cache->classified ? (int)CACHE_NUM_FIELDS
+                           : (int)CACHE_NUM_FIELDS - CACHE_CLASS_FIELDS;
+}
+
+static void stats_print_cache_json(FILE* out, const CacheStats* cache) {
+  fprintf(out, "{");
+  for (size_t i = 0; i < CACHE_NUM_FIELDS; i++) {
+    fprintf(out, "%s\"%s\": ", i > 0 ? ", " : "", cache_fields[i].name);
+    if ((int)i < stats_cache_fields(cache)) {
+      stats_print_value(out, &cache_fields[i], cache, 1);
+    } else {
+      fprintf(out, "null");
+    }
+  }
+  fprintf(out, "}");
+}
+
+void stats_print_json(FILE* out, const UCMStats* stats) {
+  fprintf(out, "{");
+  for (size_t i = 0; i < STATS_NUM_FIELDS; i++) {
+    fprintf(out, "\"%s\": ", stats_fields[i].name);
+    stats_print_value(out, &stats_fields[i], stats, 1);
+    fprintf(out, ", ");
+  }
+
+  fprintf(out, "\"caches\": [");
+  for (int level = 0; level < stats->num_levels; level++) {
+    if (level > 0) fprintf(out, ", ");
+    stats_print_cache_json(out, &stats->levels[level]);
+  }
+  fprintf(out, "], \"l1i\": ");
+  if (stats->has_l1i) {
+    stats_print_cache_json(out, &stats->l1i);
+  } else {
+    fprintf(out, "null");
+  }
+  fprintf(out, ", \"victim\": ");
+  if (stats->has_victim) {
+    stats_print_cache_json(out, &stats->victim);
+  } else {
+    fprintf(out, "null");
+  }
+  fprintf(out, "}");
+}
+
+static void stats_print_cache_header(FILE* out, const char* prefix) {
+  for (size_t i = 0; i < CACHE_NUM_FIELDS; i++) {
+    fprintf(out, ",%s_%s", prefix, cache_fields[i].name);
+  }
+}
+
+void stats_print_csv_header(FILE* out, int levels) {
+  for (size_t i = 0; i < STATS_NUM_FIELDS; i++) {
+    fprintf(out, "%s%s", i > 0 ? "," : "", stats_fields[i].name);
+  }
+
+  char prefix[16];
+  for (int level = 0; level < levels; level++) {
+    snprintf(prefix, sizeof(prefix), "l%d", level + 1);
+    stats_print_cache_header(out, prefix);
+  }
+  stats_print_cache_header(out, "l1i");
+  stats_print_cache_header(out, "victim");
+  fprintf(out, "\n");
+}
+
+// A cache's columns (all empty if the hierarchy does not have it)
+static void stats_print_cache_csv(FILE* out, const CacheStats* cache) {
+  int present = (cache != NULL) ? stats_cache_fields(cache) : 0;
+
+  for (int i = 0; i < (int)CACHE_NUM_FIELDS; i++) {
+    fprintf(out, ",");
+    if (i < present) stats_print_value(out, &cache_fields[i], cache, 0);
+  }
+}
+
+void stats_print_csv_row(FILE* out, const UCMStats* stats, int levels) {
+  for (size_t i = 0; i < STATS_NUM_FIELDS; i++) {
+    if (i > 0) fprintf(out, ",");
+    stats_print_value(out, &stats_fields[i], stats, 0);
+  }
+
+  for (int level = 0; level < levels; level++) {
+    stats_print_cache_csv(out, level < stats->num_levels
+                                   ? &stats->levels[level]
+                                   : NULL);
+  }
+  stats_print_cache_csv(out, stats->has_l1i ? &stats->l1i : NULL);
+  stats_print_cache_csv(out, stats->has_victim ? &stats->victim : NULL);
+  fprintf(out, "\n");
+}
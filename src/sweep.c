@@ -0,0 +1,426 @@
+#define _POSIX_C_SOURCE 200809L  // sysconf
+
+#include "include/sweep.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "include/cli.h"
+#include "include/opcodes.h"
+#include "include/ram.h"
+
+#define SWEEP_LINE_SIZE 512
+#define SWEEP_MAX_VALUES 64
+#define SWEEP_MAX_THREADS 256
+
+static int sweep_append(SweepPoint** points, int* count, int* capacity,
+                        const UCMConfig* config, const char* label) {
+  if (*count == *capacity) {
+    int new_capacity = (*capacity == 0) ? 16 : *capacity * 2;
+    SweepPoint* grown =
+        (SweepPoint*)realloc(*points, new_capacity * sizeof(SweepPoint));
+    if (grown == NULL) return -1;
+
+    *points = grown;
+    *capacity = new_capacity;
+  }
+
+  SweepPoint* point = &(*points)[(*count)++];
+  memset(point, 0, sizeof(*point));
+  point->config = *config;
+  snprintf(point->label, sizeof(point->label), "%s", label);
+  return 0;
+}
+
+int sweep_load_file(const char* path, const UCMConfig* base,
+                    SweepPoint** points, int* count) {
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    fprintf(stderr, "Error: could not open sweep file '%s'\n", path);
+    return -1;
+  }
+
+  *points = NULL;
+  *count = 0;
+  int capacity = 0;
+  int line_number = 0;
+  char buffer[SWEEP_LINE_SIZE];
+
+  while (fgets(buffer, sizeof(buffer), file) != NULL) {
+    line_number++;
+
+    char* comment = strchr(buffer, '#');
+    if (comment != NULL) *comment = '\0';
+
+    UCMConfig config = *base;
+    int options = 0;
+    char label[SWEEP_LABEL_SIZE] = "";
+    size_t label_used = 0;
+
+    // Whitespace-separated "key=value" tokens
+    char* token = buffer;
+    while (*token != '\0') {
+      while (*token == ' ' || *token == '\t' || *token == '\n' ||
+             *token == '\r') {
+        token++;
+      }
+      if (*token == '\0') break;
+
+      char* end = token;
+      while (*end != '\0' && *end != ' ' && *end != '\t' && *end != '\n' &&
+             *end != '\r') {
+        end++;
+      }
+      char saved = *end;
+      *end = '\0';
+
+      char* equals = strchr(token, '=');
+      if (equals == NULL) {
+        fprintf(stderr, "%s:%d: expected 'key=value', got '%s'\n", path,
+                line_number, token);
+        fclose(file);
+        return -1;
+      }
+      *equals = '\0';
+      if (cli_set_option(&config, token, equals + 1) != 0) {
+        fprintf(stderr, "%s:%d: invalid option '%s=%s'\n", path, line_number,
+                token, equals + 1);
+        fclose(file);
+        return -1;
+      }
+      options++;
+
+      // The table shows the geometry in its own columns
+      if (strcmp(token, "levels") != 0 && strcmp(token, "lines") != 0 &&
+          strcmp(token, "latency") != 0 && strcmp(token, "assoc") != 0 &&
+          label_used < sizeof(label)) {
+        label_used += snprintf(label + label_used, sizeof(label) - label_used,
+                               "%s%s=%s", label_used > 0 ? " " : "", token,
+                               equals + 1);
+      }
+
+      *end = saved;
+      token = end;
+    }
+
+    if (options > 0 &&
+        sweep_append(points, count, &capacity, &config, label) != 0) {
+      fclose(file);
+      return -1;
+    }
+  }
+
+  fclose(file);
+  return 0;
+}
+
+// One axis of the grid: the candidates of one field of one level
+typedef struct SweepAxis {
+  int* field;   // Array in the config being built (lines, latency, ...)
+  int level;
+  int values[SWEEP_MAX_VALUES];
+  int num_values;
+} SweepAxis;
+
+// Split "a,b/c/d,e" into one axis per level; returns how many levels
+static int sweep_parse_grid(const char* grid, int* field, SweepAxis* axes,
+                            int* num_axes) {
+  char buffer[SWEEP_LINE_SIZE];
+  if (strlen(grid) >= sizeof(buffer)) return -1;
+  strcpy(buffer, grid);
+
+  int level = 0;
+  char* group = buffer;
+  while (group != NULL) {
+    char* slash = strchr(group, '/');
+    if (slash != NULL) *slash = '\0';
+
+    if (level == UCM_MAX_LEVELS) return -1;
+
+    SweepAxis* axis = &axes[(*num_axes)++];
+    axis->field = field;
+    axis->level = level++;
+    axis->num_values =
+        cli_parse_int_list(group, axis->values, SWEEP_MAX_VALUES);
+    if (axis->num_values < 1) return -1;
+
+    group = (slash != NULL) ? slash + 1 : NULL;
+  }
+
+  return level;
+}
+
+int sweep_build_grid(const UCMConfig* base, const char* lines_grid,
+                     const char* latency_grid, const char* assoc_grid,
+                     SweepPoint** points, int* count) {
+  UCMConfig config = *base;
+  SweepAxis axes[3 * UCM_MAX_LEVELS];
+  int num_axes = 0;
+
+  *points = NULL;
+  *count = 0;
+
+  if (lines_grid != NULL) {
+    int levels = sweep_parse_grid(lines_grid, config.lines, axes, &num_axes);
+    if (levels < 0) return -1;
+    config.num_levels = levels;
+  }
+  if (latency_grid != NULL &&
+      sweep_parse_grid(latency_grid, config.latency, axes, &num_axes) < 0) {
+    return -1;
+  }
+  if (assoc_grid != NULL &&
+      sweep_parse_grid(assoc_grid, config.associativity, axes, &num_axes) < 0) {
+    return -1;
+  }
+
+  // Walk the cartesian product like an odometer
+  int digits[3 * UCM_MAX_LEVELS] = {0};
+  int capacity = 0;
+
+  for (;;) {
+    for (int a = 0; a < num_axes; a++) {
+      axes[a].field[axes[a].level] = axes[a].values[digits[a]];
+    }
+    if (sweep_append(points, count, &capacity, &config, "") != 0) return -1;
+
+    int a = 0;
+    while (a < num_axes && ++digits[a] == axes[a].num_values) {
+      digits[a] = 0;
+      a++;
+    }
+    if (a == num_axes) break;
+  }
+
+  return 0;
+}
+
+int sweep_default_threads(void) {
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  return (cores > 0) ? (int)cores : 1;
+}
+
+// Shared by every worker; only `next` is written concurrently
+typedef struct SweepJob {
+  SweepPoint* points;
+  int count;
+  const ProgramInfo* program;
+  int arg1;
+  int arg2;
+  const TraceReader* trace;
+  atomic_int next;
+} SweepJob;
+
+static void sweep_run_point(const SweepJob* job, SweepPoint* point) {
+  uint64_t ram_words = point->config.ram_words;
+  if (job->trace != NULL && job->trace->max_address + 1 > ram_words) {
+    ram_words = job->trace->max_address + 1;
+  }
+
+  // Sweeps leave the 3C split out, so don't pay for it
+  UCMConfig config = point->config;
+  config.classify_misses = 0;
+
+  RAM* ram = ucm_create_ram(&config, ram_words);
+  UCM* ucm = ucm_create_with_config(ram, &config);
+
+  point->ok = 0;
+  if (ram == NULL || ucm == NULL) {
+    destroy_ram(ram);
+    return;
+  }
+
+  if (job->trace != NULL) {
+    trace_replay(job->trace, ucm);
+  } else {
+    Register reg = {0, 0, 0, 0, 0};
+    job->program->run(ucm, &reg, job->arg1, job->arg2);
+  }
+
+  point->ok = 1;
+  ucm_get_stats(ucm, &point->stats);
+
+  ucm_destroy(ucm);
+  destroy_ram(ram);
+}
+
+static void* sweep_worker(void* arg) {
+  SweepJob* job = (SweepJob*)arg;
+
+  for (;;) {
+    int index = atomic_fetch_add(&job->next, 1);
+    if (index >= job->count) break;
+
+    sweep_run_point(job, &job->points[index]);
+  }
+
+  return NULL;
+}
+
+void sweep_run(SweepPoint* points, int count, const ProgramInfo* program,
+               int arg1, int arg2, const TraceReader* trace, int threads) {
+  SweepJob job;
+  job.points = points;
+  job.count = count;
+  job.program = program;
+  job.arg1 = arg1;
+  job.arg2 = arg2;
+  job.trace = trace;
+  atomic_init(&job.next, 0);
+
+  if (threads <= 0) threads = sweep_default_threads();
+  if (threads > count) threads = count;
+  if (threads > SWEEP_MAX_THREADS) threads = SWEEP_MAX_THREADS;
+
+  // Programs would interleave their output across threads
+  program_set_verbose(0);
+
+  pthread_t workers[SWEEP_MAX_THREADS];
+  int started = 0;
+  for (int i = 0; i < threads; i++) {
+    if (pthread_create(&workers[i], NULL, sweep_worker, &job) != 0) break;
+    started++;
+  }
+
+  // No thread could start: do the work here
+  if (started == 0) sweep_worker(&job);
+
+  for (int i = 0; i < started; i++) {
+    pthread_join(workers[i], NULL);
+  }
+
+  program_set_verbose(1);
+}
+
+static double sweep_rate(int part, int whole) {
+  return (whole > 0) ? (double)part * 100.0 / (double)whole : 0.0;
+}
+
+// "a/b/c" from one value per level (FA for a fully associative level)
+static void sweep_format_levels(char* out, size_t size, const int* values,
+                                int levels, int fa_zero) {
+  size_t used = 0;
+  out[0] = '\0';
+  for (int level = 0; level < levels && used < size; level++) {
+    const char* separator = level > 0 ? "/" : "";
+    if (fa_zero && values[level] == 0) {
+      used += snprintf(out + used, size - used, "%sFA", separator);
+    } else {
+      used += snprintf(out + used, size - used, "%s%d", separator,
+                       values[level]);
+    }
+  }
+}
+
+void sweep_print_table(FILE* out, const SweepPoint* points, int count) {
+  int levels = 0;
+  int labeled = 0;
+  for (int i = 0; i < count; i++) {
+    if (points[i].config.num_levels > levels) {
+      levels = points[i].config.num_levels;
+    }
+    if (points[i].label[0] != '\0') labeled = 1;
+  }
+
+  for (int level = 0; level < levels; level++) {
+    fprintf(out, "Cache %d  | ", level + 1);
+  }
+  fprintf(out, "Latências       | Vias            | ");
+  for (int level = 0; level < levels; level++) {
+    fprintf(out, "Taxa C%d %% | ", level + 1);
+  }
+  fprintf(out, "Taxa de RAM %% | Taxa de disco %%  | Tempo de execução (unidade)");
+  fprintf(out, labeled ? " | Opções\n" : "\n");
+
+  for (int level = 0; level < levels; level++) {
+    fprintf(out, "---------|-");
+  }
+  fprintf(out, "----------------|-----------------|-");
+  for (int level = 0; level < levels; level++) {
+    fprintf(out, "----------|-");
+  }
+  fprintf(out, "--------------|------------------|-------------------------------");
+  fprintf(out, labeled ? "|-------\n" : "\n");
+
+  for (int i = 0; i < count; i++) {
+    const SweepPoint* point = &points[i];
+    const UCMConfig* config = &point->config;
+
+    for (int level = 0; level < levels; level++) {
+      if (level < config->num_levels) {
+        fprintf(out, "%8d | ", config->lines[level]);
+      } else {
+        fprintf(out, "%8s | ", "-");
+      }
+    }
+
+    char latencies[64];
+    sweep_format_levels(latencies, sizeof(latencies), config->latency,
+                        config->num_levels, 0);
+    char ways[64];
+    sweep_format_levels(ways, sizeof(ways), config->associativity,
+                        config->num_levels, 1);
+    fprintf(out, "%-15s | %-15s | ", latencies, ways);
+
+    if (!point->ok) {
+      fprintf(out, "invalid hierarchy");
+      fprintf(out, labeled ? " | %s\n" : "\n", point->label);
+      continue;
+    }
+
+    const UCMStats* stats = &point->stats;
+    for (int level = 0; level < levels; level++) {
+      if (level < config->num_levels) {
+        const CacheStats* cache = &stats->levels[level];
+        double rate = sweep_rate(cache->hits, cache->hits + cache->misses);
+        fprintf(out, "%8.2f%% | ", rate);
+      } else {
+        fprintf(out, "%9s | ", "-");
+      }
+    }
+
+    fprintf(out, "%12.2f%% | %15.2f%% | %29llu",
+            sweep_rate(stats->total_misses, stats->total_accesses),
+            sweep_rate(stats->disk_accesses, stats->total_accesses),
+            (unsigned long long)stats->total_time);
+    fprintf(out, labeled ? " | %s\n" : "\n", point->label);
+  }
+}
+
+void sweep_print_stats(FILE* out, const SweepPoint* points, int count,
+                       StatsFormat format) {
+  int levels = 0;
+  for (int i = 0; i < count; i++) {
+    if (points[i].config.num_levels > levels) {
+      levels = points[i].config.num_levels;
+    }
+  }
+
+  if (format == STATS_CSV) {
+    stats_print_csv_header(out, levels);
+  } else {
+    fprintf(out, "[\n");
+  }
+
+  int printed = 0;
+  for (int i = 0; i < count; i++) {
+    if (!points[i].ok) {
+      fprintf(stderr, "Warning: sweep point %d is not a valid hierarchy\n",
+              i + 1);
+      continue;
+    }
+
+    if (format == STATS_CSV) {
+      stats_print_csv_row(out, &points[i].stats, levels);
+    } else {
+      if (printed > 0) fprintf(out, ",\n");
+      stats_print_json(out, &points[i].stats);
+    }
+    printed++;
+  }
+
+  if (format != STATS_CSV) fprintf(out, "\n]\n");
+}
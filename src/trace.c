@@ -0,0 +1,253 @@
+#define _POSIX_C_SOURCE 200809L  // mmap, open
+
+#include "include/trace.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TRACE_MAGIC "UCMTRACE"
+#define TRACE_VERSION 2     // 2 added instruction fetches to the head
+#define TRACE_MAX_RECORD 20  // Two 10-byte varints
+#define TRACE_REPLAY_BATCH 4096  // Records decoded per ucm_access_batch
+
+static void put_u32(unsigned char* out, uint32_t value) {
+  for (int i = 0; i < 4; i++) out[i] = (unsigned char)(value >> (8 * i));
+}
+
+static void put_u64(unsigned char* out, uint64_t value) {
+  for (int i = 0; i < 8; i++) out[i] = (unsigned char)(value >> (8 * i));
+}
+
+static uint32_t get_u32(const unsigned char* in) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; i++) value |= (uint32_t)in[i] << (8 * i);
+  return value;
+}
+
+static uint64_t get_u64(const unsigned char* in) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; i++) value |= (uint64_t)in[i] << (8 * i);
+  return value;
+}
+
+// Small negative numbers become small unsigned ones: 0,-1,1,-2 → 0,1,2,3
+static uint64_t zigzag_encode(int64_t value) {
+  return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t zigzag_decode(uint64_t value) {
+  return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static size_t varint_encode(unsigned char* out, uint64_t value) {
+  size_t n = 0;
+  while (value >= 0x80) {
+    out[n++] = (unsigned char)(value | 0x80);
+    value >>= 7;
+  }
+  out[n++] = (unsigned char)value;
+  return n;
+}
+
+// Returns bytes consumed, 0 if the varint runs past the end
+static size_t varint_decode(const unsigned char* in, size_t available,
+                            uint64_t* value) {
+  uint64_t result = 0;
+  for (size_t n = 0; n < available && n < 10; n++) {
+    result |= (uint64_t)(in[n] & 0x7F) << (7 * n);
+    if ((in[n] & 0x80) == 0) {
+      *value = result;
+      return n + 1;
+    }
+  }
+  return 0;
+}
+
+static void trace_write_header(TraceWriter* writer) {
+  unsigned char header[TRACE_HEADER_SIZE] = {0};
+  memcpy(header, TRACE_MAGIC, 8);
+  put_u32(header + 8, TRACE_VERSION);
+  put_u64(header + 16, writer->count);
+  put_u64(header + 24, writer->max_address);
+
+  fwrite(header, 1, sizeof(header), writer->file);
+}
+
+static void trace_writer_flush(TraceWriter* writer) {
+  if (writer->used > 0) {
+    fwrite(writer->buffer, 1, writer->used, writer->file);
+    writer->used = 0;
+  }
+}
+
+TraceWriter* trace_writer_open(const char* path) {
+  TraceWriter* writer = (TraceWriter*)malloc(sizeof(TraceWriter));
+  if (writer == NULL) return NULL;
+
+  writer->file = fopen(path, "wb");
+  if (writer->file == NULL) {
+    free(writer);
+    return NULL;
+  }
+
+  writer->used = 0;
+  writer->last_address = 0;
+  writer->count = 0;
+  writer->max_address = 0;
+
+  // Placeholder; the counts are filled in by trace_writer_close
+  trace_write_header(writer);
+
+  return writer;
+}
+
+void trace_writer_record(TraceWriter* writer, uint64_t address,
+                         UCM_Operation operation, int value) {
+  if (writer == NULL) return;
+
+  if (writer->used + TRACE_MAX_RECORD > TRACE_BUFFER_SIZE) {
+    trace_writer_flush(writer);
+  }
+
+  int64_t delta = (int64_t)(address - writer->last_address);
+  uint64_t head = (zigzag_encode(delta) << 2) | (uint64_t)operation;
+  unsigned char* out = writer->buffer + writer->used;
+
+  size_t n = varint_encode(out, head);
+  if (operation == UCM_WRITE) {
+    n += varint_encode(out + n, zigzag_encode(value));
+  }
+  writer->used += n;
+
+  writer->last_address = address;
+  writer->count++;
+  if (address > writer->max_address) writer->max_address = address;
+}
+
+int trace_writer_close(TraceWriter* writer) {
+  if (writer == NULL) return -1;
+
+  trace_writer_flush(writer);
+
+  rewind(writer->file);
+  trace_write_header(writer);
+
+  int status = ferror(writer->file) ? -1 : 0;
+  if (fclose(writer->file) != 0) status = -1;
+  free(writer);
+
+  return status;
+}
+
+TraceReader* trace_reader_open(const char* path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return NULL;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t)info.st_size < TRACE_HEADER_SIZE) {
+    close(fd);
+    return NULL;
+  }
+
+  size_t size = (size_t)info.st_size;
+  void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);  // The mapping stays valid
+  if (data == MAP_FAILED) return NULL;
+
+  const unsigned char* bytes = (const unsigned char*)data;
+  uint32_t version = get_u32(bytes + 8);
+  if (memcmp(bytes, TRACE_MAGIC, 8) != 0 || version < 1 ||
+      version > TRACE_VERSION) {
+    munmap(data, size);
+    return NULL;
+  }
+
+  // The file is read front to back exactly once
+  posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
+
+  TraceReader* reader = (TraceReader*)malloc(sizeof(TraceReader));
+  if (reader == NULL) {
+    munmap(data, size);
+    return NULL;
+  }
+
+  reader->data = bytes;
+  reader->size = size;
+  reader->version = (int)version;
+  reader->count = get_u64(bytes + 16);
+  reader->max_address = get_u64(bytes + 24);
+
+  return reader;
+}
+
+void trace_reader_close(TraceReader* reader) {
+  if (reader == NULL) return;
+
+  munmap((void*)reader->data, reader->size);
+  free(reader);
+}
+
+uint64_t trace_replay(const TraceReader* reader, UCM* ucm) {
+  if (reader == NULL || ucm == NULL) return 0;
+
+  const unsigned char* p = reader->data + TRACE_HEADER_SIZE;
+  const unsigned char* end = reader->data + reader->size;
+  uint64_t address = 0;
+  uint64_t replayed = 0;
+
+  // Version 1 had only reads and writes, in one bit
+  int op_bits = (reader->version == 1) ? 1 : 2;
+  uint64_t op_mask = ((uint64_t)1 << op_bits) - 1;
+
+  // Records are decoded a batch at a time and handed over in one call
+  uint64_t addresses[TRACE_REPLAY_BATCH];
+  UCM_Operation operations[TRACE_REPLAY_BATCH];
+  int values[TRACE_REPLAY_BATCH];
+
+  int done = 0;
+  while (!done) {
+    size_t count = 0;
+    while (count < TRACE_REPLAY_BATCH) {
+      uint64_t head;
+      size_t n = (p < end) ? varint_decode(p, (size_t)(end - p), &head) : 0;
+      if (n == 0) {  // End of file or truncated record
+        done = 1;
+        break;
+      }
+      p += n;
+
+      address += (uint64_t)zigzag_decode(head >> op_bits);
+      UCM_Operation operation = (UCM_Operation)(head & op_mask);
+      if (operation > UCM_FETCH) {  // Corrupt record
+        done = 1;
+        break;
+      }
+
+      int value = 0;
+      if (operation == UCM_WRITE) {
+        uint64_t encoded;
+        n = varint_decode(p, (size_t)(end - p), &encoded);
+        if (n == 0) {
+          done = 1;
+          break;
+        }
+        p += n;
+        value = (int)zigzag_decode(encoded);
+      }
+
+      addresses[count] = address;
+      operations[count] = operation;
+      values[count] = value;
+      count++;
+    }
+
+    replayed += ucm_access_batch(ucm, addresses, operations, values, NULL,
+                                 count);
+  }
+
+  return replayed;
+}
@@ -2,208 +2,1240 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-#ifndef L1_SIZE
-#define L1_SIZE 32
-#endif
+#include "include/profile.h"
+#include "include/reuse.h"
+#include "include/smp.h"
+#include "include/trace.h"
 
-#ifndef L2_SIZE
-#define L2_SIZE 64
-#endif
+void ucm_config_default(UCMConfig* config) {
+  if (config == NULL) return;
 
-#ifndef L3_SIZE
-#define L3_SIZE 128
-#endif
+  config->num_levels = 3;
+
+  config->lines[0] = 32;
+  config->lines[1] = 64;
+  config->lines[2] = 128;
+
+  config->latency[0] = 1;
+  config->latency[1] = 10;
+  config->latency[2] = 50;
+
+  for (int i = 0; i < UCM_MAX_LEVELS; i++) {
+    config->associativity[i] = 0;  // Fully associative
+    config->mshrs[i] = 0;          // Blocking
+    if (i >= 3) {
+      config->lines[i] = 0;
+      config->latency[i] = UCM_LATENCY_UNSET;
+    }
+  }
+
+  config->block_words = BLOCK_DEFAULT_WORDS;
+  config->ram_latency = 100;
+  config->ram_words = RAM_DEFAULT_WORDS;
+  config->ram_image = NULL;
+  config->ram_frames = 0;
+  config->page_words = 16;
+  config->page_policy = RAM_PAGE_LRU;
+  config->disk_latency = 10000;
+  config->write_policy = UCM_WRITE_THROUGH;
+  config->allocate_policy = UCM_WRITE_ALLOCATE;
+  config->fetch = 0;
+  config->l1i_lines = 32;
+  config->l1i_associativity = 0;
+  config->l1i_latency = 1;
+  config->code_base = UCM_CODE_BASE;
+  config->inclusion = UCM_NINE;
+  config->victim_lines = 0;
+  config->victim_latency = 2;
+  config->prefetch = PREFETCH_NONE;
+  config->prefetch_degree = 1;
+  config->prefetch_level = 1;
+  config->classify_misses = 0;
+}
 
 UCM* ucm_create(RAM* ram) {
+  return ucm_create_with_config(ram, NULL);
+}
+
+RAM* ucm_create_ram(const UCMConfig* config, uint64_t num_words) {
+  UCMConfig defaults;
+  if (config == NULL) {
+    ucm_config_default(&defaults);
+    config = &defaults;
+  }
+
+  if (num_words == 0 || num_words > RAM_MAX_WORDS) return NULL;
+
+  // Blocks never straddle pages
+  if (config->ram_frames > 0 && config->page_words % config->block_words) {
+    return NULL;
+  }
+
+  RAM* ram = NULL;
+  if (config->ram_frames <= 0) {
+    ram = create_empty_ram(num_words);
+  } else if (config->page_words > 0) {
+    ram = create_swapped_ram(num_words, (size_t)config->ram_frames,
+                             (size_t)config->page_words, config->page_policy);
+  }
+
+  // Start from a saved image instead of zeros
+  if (ram != NULL && config->ram_image != NULL &&
+      ram_load_image(ram, config->ram_image) != 0) {
+    destroy_ram(ram);
+    return NULL;
+  }
+
+  return ram;
+}
+
+UCM* ucm_create_with_config(RAM* ram, const UCMConfig* config) {
+  UCMConfig defaults;
+  if (config == NULL) {
+    ucm_config_default(&defaults);
+    config = &defaults;
+  }
+
   if (ram == NULL) return NULL;
+  if (config->num_levels < 1 || config->num_levels > UCM_MAX_LEVELS) {
+    return NULL;
+  }
+  for (int i = 0; i < config->num_levels; i++) {
+    if (config->latency[i] < 0) return NULL;  // Negative or never given
+  }
+  if (config->ram_latency < 0 || config->disk_latency < 0 ||
+      config->l1i_latency < 0 || config->victim_latency < 0) {
+    return NULL;
+  }
+  if (config->fetch && config->code_base >= ram->num_words) return NULL;
+
+  BlockShape block;
+  if (block_shape_init(&block, config->block_words) != 0) return NULL;
+
+  if (config->prefetch != PREFETCH_NONE &&
+      (config->prefetch_level < 1 ||
+       config->prefetch_level > config->num_levels)) {
+    return NULL;
+  }
 
   UCM* ucm = (UCM*)malloc(sizeof(UCM));
   if (ucm == NULL) return NULL;
 
-  ucm->L1 = cache_create(L1_SIZE, 1);
-  ucm->L2 = cache_create(L2_SIZE, 10);
-  ucm->L3 = cache_create(L3_SIZE, 50);
+  ucm->block = block;
+  ucm->num_levels = config->num_levels;
+  for (int i = 0; i < ucm->num_levels; i++) {
+    ucm->levels[i] = cache_create_assoc(config->lines[i],
+                                        config->associativity[i],
+                                        config->block_words,
+                                        config->latency[i]);
 
-  // Check if all caches were created successfully
-  if (ucm->L1 == NULL || ucm->L2 == NULL || ucm->L3 == NULL) {
-    if (ucm->L1) cache_destroy(ucm->L1);
-    if (ucm->L2) cache_destroy(ucm->L2);
-    if (ucm->L3) cache_destroy(ucm->L3);
-    free(ucm);
-    return NULL;
+    // Check if every cache was created successfully
+    if (ucm->levels[i] == NULL) {
+      for (int j = 0; j < i; j++) {
+        cache_destroy(ucm->levels[j]);
+      }
+      free(ucm);
+      return NULL;
+    }
   }
 
   ucm->ram = ram;
-  ucm->global_time = 0;
+  ucm->ram_latency = config->ram_latency;
+  ucm->disk_latency = config->disk_latency;
+  ucm->write_policy = config->write_policy;
+  ucm->allocate_policy = config->allocate_policy;
+  ucm->inclusion = config->inclusion;
   ucm->total_accesses = 0;
   ucm->total_hits = 0;
   ucm->total_misses = 0;
+  ucm->disk_accesses = 0;
+  ucm->write_accesses = 0;
+  ucm->write_misses = 0;
+  ucm->write_allocates = 0;
+  ucm->write_arounds = 0;
+  ucm->back_invalidations = 0;
   ucm->total_time = 0;
+  ucm->trace = NULL;
+  ucm->reuse = NULL;
+  ucm->profile = NULL;
+  ucm->smp = NULL;
+  ucm->core = 0;
+  ucm->source = 0;
+
+  ucm->nonblocking = (config->mshrs[0] > 0);
+  ucm->overlap_depth = 0;
+  ucm->clock = 0;
+  ucm->next_issue = 0;
+  ucm->overlap_end = 0;
+  ucm->miss_end = 0;
+  ucm->mshr_merges = 0;
+  ucm->mshr_stalls = 0;
+  ucm->miss_cycles = 0;
+  ucm->miss_busy = 0;
+  for (int i = 0; i < UCM_MAX_LEVELS; i++) {
+    ucm->mshrs[i] = NULL;
+    ucm->mshr_count[i] = 0;
+  }
+
+  ucm->l1d = ucm->levels[0];
+  ucm->l1i = NULL;
+  ucm->fetch = config->fetch;
+  ucm->code_base = config->code_base;
+  ucm->fetch_accesses = 0;
+  ucm->fetch_hits = 0;
+  ucm->fetch_misses = 0;
+  ucm->fetch_time = 0;
+
+  ucm->victim = NULL;
+  ucm->prefetcher = NULL;
+  ucm->batch_mask = 15;
+  while (ucm->batch_mask < (uint64_t)ucm->l1d->num_lines - 1) {
+    ucm->batch_mask = ucm->batch_mask * 2 + 1;
+  }
+  ucm->batch_lines =
+      (CacheLine**)calloc(ucm->batch_mask + 1, sizeof(CacheLine*));
+  if (ucm->batch_lines == NULL) {
+    ucm_destroy(ucm);
+    return NULL;
+  }
+  for (int i = 0; ucm->nonblocking && i < ucm->num_levels; i++) {
+    if (config->mshrs[i] <= 0) continue;  // No limit below L1
+
+    ucm->mshr_count[i] = config->mshrs[i];
+    ucm->mshrs[i] = (UCMMshr*)calloc(config->mshrs[i], sizeof(UCMMshr));
+    if (ucm->mshrs[i] == NULL) {
+      ucm_destroy(ucm);
+      return NULL;
+    }
+  }
+  ucm->prefetch_level = config->prefetch_level - 1;
+  ucm->prefetch_pending = 0;
+  ucm->prefetch_block = 0;
+  if (config->fetch && config->l1i_lines > 0) {
+    ucm->l1i = cache_create_assoc(config->l1i_lines,
+                                  config->l1i_associativity,
+                                  config->block_words, config->l1i_latency);
+    if (ucm->l1i == NULL) {
+      ucm_destroy(ucm);
+      return NULL;
+    }
+  }
+  if (config->victim_lines > 0) {
+    ucm->victim = cache_create(config->victim_lines, config->block_words,
+                               config->victim_latency);
+    if (ucm->victim == NULL) {
+      ucm_destroy(ucm);
+      return NULL;
+    }
+  }
+  if (config->prefetch != PREFETCH_NONE) {
+    ucm->prefetcher =
+        prefetcher_create(config->prefetch, config->prefetch_degree);
+    if (ucm->prefetcher == NULL) {
+      ucm_destroy(ucm);
+      return NULL;
+    }
+  }
+  if (config->classify_misses) {
+    int failed = 0;
+    for (int i = 0; i < ucm->num_levels; i++) {
+      failed |= cache_classify_misses(ucm->levels[i]);
+    }
+    if (ucm->l1i != NULL) failed |= cache_classify_misses(ucm->l1i);
+    if (ucm->victim != NULL) failed |= cache_classify_misses(ucm->victim);
+    if (failed) {
+      ucm_destroy(ucm);
+      return NULL;
+    }
+  }
 
   return ucm;
 }
 
+static void ucm_ram_read(UCM* ucm, uint64_t block_address, int* dest) {
+  get_ram_words(ucm->ram, block_to_word(&ucm->block, block_address), dest,
+                (size_t)ucm->block.words);
+}
+
+static void ucm_ram_write(UCM* ucm, uint64_t block_address, const int* src) {
+  set_ram_words(ucm->ram, block_to_word(&ucm->block, block_address), src,
+                (size_t)ucm->block.words);
+}
+
+// Write every dirty line straight to RAM. Upper levels always hold the
+// newest copy, so flushing the last level first and L1 last leaves RAM up
+// to date.
+static void ucm_flush_cache(UCM* ucm, Cache* cache) {
+  for (int i = 0; i < cache->num_lines; i++) {
+    CacheLine* line = &cache->lines[i];
+    if (line->valid && line->dirty) {
+      ucm_ram_write(ucm, line->tag, line->data);
+      line->dirty = 0;
+    }
+  }
+}
+
+void ucm_flush(UCM* ucm) {
+  if (ucm == NULL) return;
+
+  // A core's dirty lines may belong below the shared level, not in RAM
+  if (ucm->smp != NULL) {
+    smp_flush(ucm->smp);
+    return;
+  }
+
+  for (int level = ucm->num_levels - 1; level >= 0; level--) {
+    ucm_flush_cache(ucm, ucm->levels[level]);
+
+    // The victim cache sits between L1 and L2 (it never holds L1's blocks)
+    if (level == 1 && ucm->victim != NULL) {
+      ucm_flush_cache(ucm, ucm->victim);
+    }
+  }
+  if (ucm->num_levels == 1 && ucm->victim != NULL) {
+    ucm_flush_cache(ucm, ucm->victim);
+  }
+  if (ucm->l1i != NULL) ucm_flush_cache(ucm, ucm->l1i);
+}
+
 void ucm_destroy(UCM* ucm) {
   if (ucm == NULL) return;
 
-  if (ucm->L1) cache_destroy(ucm->L1);
-  if (ucm->L2) cache_destroy(ucm->L2);
-  if (ucm->L3) cache_destroy(ucm->L3);
+  ucm_flush(ucm);
+
+  for (int level = 0; level < ucm->num_levels; level++) {
+    cache_destroy(ucm->levels[level]);
+  }
+  cache_destroy(ucm->l1i);
+  cache_destroy(ucm->victim);
+  free(ucm->batch_lines);
+  for (int level = 0; level < UCM_MAX_LEVELS; level++) {
+    free(ucm->mshrs[level]);
+  }
+  prefetcher_destroy(ucm->prefetcher);
 
   free(ucm);
 }
 
-static void ucm_handle_miss(UCM* ucm, Cache* cache, int block_address,
-                            Block* block) {
+// Write a dirty victim into the first level below that holds its block,
+// or into RAM, charging the latency of whoever takes it
+static void ucm_write_back(UCM* ucm, int from, const CacheLine* victim,
+                           int* access_time) {
+  for (int level = from + 1; level < ucm->num_levels; level++) {
+    Cache* below = ucm->levels[level];
+    CacheLine* line = cache_probe(below, victim->tag);
+    if (line != NULL) {
+      block_copy(line->data, victim->data, ucm->block.words);
+      line->dirty = 1;
+      *access_time += below->access_time;
+      return;
+    }
+  }
+
+  ucm_ram_write(ucm, victim->tag, victim->data);
+  *access_time += ucm->ram_latency;
+}
+
+static CacheLine* ucm_handle_miss(UCM* ucm, int level, uint64_t block_address,
+                                  const int* block, int* access_time);
+
+// Caches between L1 and `level`, top first (both L1s, victim cache, L2...)
+static int ucm_upper_caches(const UCM* ucm, int level, Cache** out) {
+  int count = 0;
+  for (int above = 0; above < level; above++) {
+    out[count++] = ucm->levels[above];
+    if (above != 0) continue;
+
+    if (ucm->l1i != NULL) {
+      out[count++] = (ucm->levels[0] == ucm->l1i) ? ucm->l1d : ucm->l1i;
+    }
+    if (ucm->victim != NULL) out[count++] = ucm->victim;
+  }
+  return count;
+}
+
+// Inclusive: `level` evicted `victim`, so drop the copies above it. The
+// topmost dirty copy is the newest one and replaces the victim's data.
+static void ucm_back_invalidate(UCM* ucm, int level, CacheLine* victim) {
+  Cache* upper[UCM_MAX_LEVELS + 2];
+  int count = ucm_upper_caches(ucm, level, upper);
+
+  for (int i = count - 1; i >= 0; i--) {
+    CacheLine* copy = cache_probe(upper[i], victim->tag);
+    if (copy == NULL) continue;
+
+    if (copy->dirty) {
+      block_copy(victim->data, copy->data, ucm->block.words);
+      victim->dirty = 1;
+      upper[i]->writebacks++;
+    }
+    cache_invalidate(upper[i], copy);
+    ucm->back_invalidations++;
+  }
+}
+
+// Exclusive: a line leaving the level above goes into `level`, pushing
+// that level's victim further down; past the last level it goes to RAM
+static void ucm_demote(UCM* ucm, int level, CacheLine* line,
+                       int* access_time) {
+  if (level >= ucm->num_levels) {
+    if (line->dirty) {
+      ucm_ram_write(ucm, line->tag, line->data);
+      *access_time += ucm->ram_latency;
+    }
+    return;
+  }
+
+  CacheLine* moved = ucm_handle_miss(ucm, level, line->tag, line->data,
+                                     access_time);
+  moved->dirty = line->dirty;
+}
+
+// A line `level` just evicted: L1's go to the victim cache when there is
+// one, everything else is written down if dirty (or moved down, exclusive)
+static void ucm_evicted(UCM* ucm, int level, CacheLine* victim,
+                        int* access_time) {
+  if (ucm->inclusion == UCM_INCLUSIVE && level > 0) {
+    ucm_back_invalidate(ucm, level, victim);
+  }
+
+  if (level == 0 && ucm->victim != NULL) {
+    CacheLine displaced;
+    int displaced_words[BLOCK_MAX_WORDS];
+    displaced.data = displaced_words;
+    CacheLine* line =
+        cache_load(ucm->victim, victim->tag, victim->data, &displaced);
+    line->dirty = victim->dirty;
+    if (!displaced.valid) return;
+
+    if (ucm->inclusion == UCM_EXCLUSIVE) {
+      ucm_demote(ucm, 1, &displaced, access_time);
+    } else if (displaced.dirty) {
+      ucm_write_back(ucm, 0, &displaced, access_time);
+    }
+    return;
+  }
+
+  if (ucm->inclusion == UCM_EXCLUSIVE) {
+    ucm_demote(ucm, level + 1, victim, access_time);
+  } else if (victim->dirty) {
+    ucm_write_back(ucm, level, victim, access_time);
+  }
+}
+
+static CacheLine* ucm_handle_miss(UCM* ucm, int level, uint64_t block_address,
+                                  const int* block, int* access_time) {
+  CacheLine victim;
+  int victim_words[BLOCK_MAX_WORDS];
+  victim.data = victim_words;
+
   // Load block into this cache
-  cache_load(cache, block_address, block, ucm->global_time);
+  CacheLine* line =
+      cache_load(ucm->levels[level], block_address, block, &victim);
+  if (victim.valid) {
+    ucm_evicted(ucm, level, &victim, access_time);
+  }
+
+  return line;
+}
+
+// Move a block from a lower cache into L1 (victim cache hits, and every
+// lower-level hit when exclusive); L1's victim takes the way down
+static CacheLine* ucm_promote(UCM* ucm, Cache* cache, CacheLine* held,
+                              int* access_time) {
+  CacheLine moved = *held;
+  int moved_words[BLOCK_MAX_WORDS];
+  block_copy(moved_words, held->data, ucm->block.words);
+  moved.data = moved_words;
+  cache_invalidate(cache, held);
+
+  CacheLine* line = ucm_handle_miss(ucm, 0, moved.tag, moved.data,
+                                    access_time);
+  line->dirty = moved.dirty;
+  return line;
+}
+
+// A demand miss on a block a prefetch had evicted from this level
+static void ucm_check_pollution(UCM* ucm, int level, uint64_t block_address) {
+  if (ucm->prefetcher != NULL &&
+      prefetcher_was_victim(ucm->prefetcher, level, ucm->num_levels,
+                            block_address)) {
+    ucm->prefetcher->polluting++;
+  }
+}
+
+// First demand use of a prefetched line: wait for it if it is still on
+// its way, and let the stream run further ahead
+static void ucm_use_prefetched(UCM* ucm, CacheLine* line, int* access_time) {
+  Prefetcher* prefetcher = ucm->prefetcher;
+  line->prefetched = 0;
+  if (prefetcher == NULL) return;
+
+  prefetcher->useful++;
+  uint64_t now = ucm->total_time + (uint64_t)*access_time;
+  if (line->ready_time > now) {
+    prefetcher->late++;
+    *access_time += (int)(line->ready_time - now);
+  }
+
+  ucm->prefetch_pending = 1;
+  ucm->prefetch_block = line->tag;
+}
+
+// Bring one block into the prefetch level (and the levels between it and
+// whoever has the block). Its latency is not charged to the program.
+static void ucm_prefetch_block(UCM* ucm, uint64_t block_address) {
+  int target = ucm->prefetch_level;
+  if (block_to_word(&ucm->block, block_address) >= ucm->ram->num_words) {
+    return;
+  }
+
+  // Nothing to do if the target level or one above it has the block
+  Cache* upper[UCM_MAX_LEVELS + 2];
+  int count = ucm_upper_caches(ucm, target + 1, upper);
+  for (int i = 0; i < count; i++) {
+    if (cache_probe(upper[i], block_address) != NULL) return;
+  }
+
+  int latency = 0;
+  int source = ucm->num_levels;
+  const int* data = NULL;
+  int ram_block[BLOCK_MAX_WORDS];
+  int dirty = 0;
+
+  for (int level = target + 1; level < ucm->num_levels; level++) {
+    latency += ucm->levels[level]->access_time;
+    CacheLine* line = cache_probe(ucm->levels[level], block_address);
+    if (line != NULL) {
+      source = level;
+      data = line->data;
+
+      // Exclusive: the block moves up instead of being copied
+      if (ucm->inclusion == UCM_EXCLUSIVE) {
+        block_copy(ram_block, line->data, ucm->block.words);
+        dirty = line->dirty;
+        data = ram_block;
+        cache_invalidate(ucm->levels[level], line);
+      }
+      break;
+    }
+  }
+  if (data == NULL) {
+    ucm_ram_read(ucm, block_address, ram_block);
+    latency += ucm->ram_latency;
+    data = ram_block;
+  }
+
+  // Exclusive fills only the target level
+  if (ucm->inclusion == UCM_EXCLUSIVE) source = target + 1;
+
+  int background_time = 0;
+  for (int level = source - 1; level >= target; level--) {
+    CacheLine victim;
+    int victim_words[BLOCK_MAX_WORDS];
+    victim.data = victim_words;
+    CacheLine* line =
+        cache_load(ucm->levels[level], block_address, data, &victim);
+    if (victim.valid) {
+      prefetcher_record_victim(ucm->prefetcher, level, ucm->num_levels,
+                               victim.tag);
+      ucm_evicted(ucm, level, &victim, &background_time);
+    }
+
+    if (level == target) {
+      line->dirty = dirty;
+      line->prefetched = 1;
+      line->ready_time = ucm->total_time + (uint64_t)latency;
+    }
+    data = line->data;
+  }
+
+  ucm->prefetcher->issued++;
 }
 
-static int ucm_read(UCM* ucm, int address) {
-  int block_address = word_to_block(address);
-  int word_offset = word_to_offset(address);
+static void ucm_prefetch(UCM* ucm, uint64_t block_address) {
+  uint64_t candidates[PREFETCH_MAX_DEGREE];
+  int count = prefetcher_candidates(ucm->prefetcher, block_address,
+                                    candidates);
 
-  ucm->global_time++;
+  for (int i = 0; i < count; i++) {
+    ucm_prefetch_block(ucm, candidates[i]);
+  }
+}
+
+// L1 missed: look for the block in L2, L3, ... and then RAM, and load it
+// into every level above the one that had it (bottom-up). Exclusive moves
+// it into L1 alone.
+// Returns the L1 line now holding the block.
+static CacheLine* ucm_fill(UCM* ucm, uint64_t block_address, int word_offset,
+                           int* access_time) {
+  if (ucm->prefetcher != NULL) {
+    ucm_check_pollution(ucm, 0, block_address);
+    ucm->prefetch_pending = 1;
+    ucm->prefetch_block = block_address;
+  }
+
+  // The victim cache is looked up in parallel with L2: a hit costs only
+  // its own latency
+  if (ucm->victim != NULL) {
+    CacheLine* held = cache_search(ucm->victim, block_address, word_offset);
+    if (held != NULL) {
+      ucm->total_hits++;
+      ucm->source = UCM_SOURCE_VICTIM;
+      *access_time += ucm->victim->access_time;
+      return ucm_promote(ucm, ucm->victim, held, access_time);
+    }
+  }
+
+  for (int level = 1; level < ucm->num_levels; level++) {
+    Cache* cache = ucm->levels[level];
+    CacheLine* line = cache_search(cache, block_address, word_offset);
+    *access_time += cache->access_time;
+
+    if (line == NULL) {
+      ucm_check_pollution(ucm, level, block_address);
+    } else {
+      // Hit on a lower level
+      ucm->total_hits++;
+      ucm->source = level;
+      cache_touch(cache, line);
+      if (line->prefetched) ucm_use_prefetched(ucm, line, access_time);
+
+      if (ucm->inclusion == UCM_EXCLUSIVE) {
+        return ucm_promote(ucm, cache, line, access_time);
+      }
+
+      CacheLine* filled = NULL;
+      for (int above = level - 1; above >= 0; above--) {
+        filled = ucm_handle_miss(ucm, above, block_address, line->data,
+                                 access_time);
+      }
+      return filled;
+    }
+  }
+
+  // Missed every level, access RAM (CACHE MISS)
+  ucm->total_misses++;
+  ucm->source = UCM_SOURCE_RAM;
+
+  int ram_block[BLOCK_MAX_WORDS];
+  ucm_ram_read(ucm, block_address, ram_block);
+  *access_time += ucm->ram_latency;
+
+  // Load block into all cache levels (only L1 when exclusive)
+  CacheLine* filled = NULL;
+  int lowest = (ucm->inclusion == UCM_EXCLUSIVE) ? 0 : ucm->num_levels - 1;
+  for (int level = lowest; level >= 0; level--) {
+    filled = ucm_handle_miss(ucm, level, block_address, ram_block,
+                             access_time);
+  }
+  return filled;
+}
+
+static int ucm_read(UCM* ucm, uint64_t address, CacheLine** l1_line) {
+  uint64_t block_address = word_to_block(&ucm->block, address);
+  int word_offset = word_to_offset(&ucm->block, address);
+  Cache* l1 = ucm->levels[0];
+
+  ucm->source = 0;
   int access_time = 0;
 
   // Step 1: Check L1 cache
-  CacheLine* line = cache_search(ucm->L1, block_address, word_offset);
-  access_time += ucm->L1->access_time;
+  CacheLine* line = cache_search(l1, block_address, word_offset);
+  access_time += l1->access_time;
 
   if (line != NULL) {
     // L1 HIT!  🎉
     ucm->total_hits++;
-    ucm->total_time += access_time;
-    line->lru_counter = ucm->global_time;  // Update LRU
-    return block_get_word(&line->data, word_offset);
+    cache_touch(l1, line);  // Update LRU
+    if (line->prefetched) ucm_use_prefetched(ucm, line, &access_time);
+  } else {
+    line = ucm_fill(ucm, block_address, word_offset, &access_time);
   }
 
-  // Step 2: L1 miss, check L2
-  line = cache_search(ucm->L2, block_address, word_offset);
-  access_time += ucm->L2->access_time;
+  ucm->total_time += access_time;
+  *l1_line = line;
+  return line->data[word_offset];
+}
 
-  if (line != NULL) {
-    // L2 HIT!
-    ucm->total_hits++;
-    line->lru_counter = ucm->global_time;
+// No-write-allocate store that missed L1: it goes around L1 to the first
+// level below holding the block, or to RAM
+static void ucm_write_around(UCM* ucm, uint64_t address, int value,
+                             int* access_time) {
+  uint64_t block_address = word_to_block(&ucm->block, address);
+  int word_offset = word_to_offset(&ucm->block, address);
 
-    // Load into L1 (inclusive cache)
-    ucm_handle_miss(ucm, ucm->L1, block_address, &line->data);
+  if (ucm->victim != NULL) {
+    CacheLine* held = cache_search(ucm->victim, block_address, word_offset);
+    if (held != NULL) {
+      ucm->total_hits++;
+      ucm->source = UCM_SOURCE_VICTIM;
+      *access_time += ucm->victim->access_time;
+      held->data[word_offset] = value;
+      cache_touch(ucm->victim, held);
+      held->dirty = 1;
+      return;
+    }
+  }
 
-    ucm->total_time += access_time;
-    return block_get_word(&line->data, word_offset);
+  for (int level = 1; level < ucm->num_levels; level++) {
+    Cache* below = ucm->levels[level];
+    CacheLine* line = cache_search(below, block_address, word_offset);
+    *access_time += below->access_time;
+
+    if (line != NULL) {
+      ucm->total_hits++;
+      ucm->source = level;
+      line->data[word_offset] = value;
+      cache_touch(below, line);
+      line->dirty = 1;
+      return;
+    }
   }
 
-  // Step 3: L2 miss, check L3
-  line = cache_search(ucm->L3, block_address, word_offset);
-  access_time += ucm->L3->access_time;
+  ucm->total_misses++;
+  ucm->source = UCM_SOURCE_RAM;
+  set_ram(ucm->ram, address, value);
+  *access_time += ucm->ram_latency;
+}
+
+static void ucm_write(UCM* ucm, uint64_t address, int value,
+                      CacheLine** l1_line) {
+  uint64_t block_address = word_to_block(&ucm->block, address);
+  int word_offset = word_to_offset(&ucm->block, address);
+  Cache* l1 = ucm->levels[0];
+
+  ucm->write_accesses++;
+  ucm->source = 0;
+  int access_time = 0;
+
+  // Try to update L1
+  CacheLine* line = cache_search(l1, block_address, word_offset);
+  access_time += l1->access_time;
 
   if (line != NULL) {
-    // L3 HIT!
+    // L1 HIT
     ucm->total_hits++;
-    line->lru_counter = ucm->global_time;
+    cache_touch(l1, line);
+    if (line->prefetched) ucm_use_prefetched(ucm, line, &access_time);
+  } else if (ucm->allocate_policy == UCM_WRITE_ALLOCATE) {
+    // L1 MISS, write-allocate: fetch the block like a read, then write it
+    ucm->write_misses++;
+    ucm->write_allocates++;
+    line = ucm_fill(ucm, block_address, word_offset, &access_time);
+  } else {
+    // L1 MISS, no-write-allocate: the caches are not filled
+    *l1_line = NULL;
+    ucm->write_misses++;
+    ucm->write_arounds++;
 
-    // Load into L2 and L1
-    ucm_handle_miss(ucm, ucm->L2, block_address, &line->data);
-    ucm_handle_miss(ucm, ucm->L1, block_address, &line->data);
+    if (ucm->write_policy == UCM_WRITE_BACK) {
+      ucm_write_around(ucm, address, value, &access_time);
+      ucm->total_time += access_time;
+      return;
+    }
+  }
 
+  if (line != NULL) {
+    line->data[word_offset] = value;
+    *l1_line = line;
+  }
+
+  if (ucm->write_policy == UCM_WRITE_BACK) {
+    // Write-Back: the store stays in L1 until the line is evicted
+    line->dirty = 1;
     ucm->total_time += access_time;
-    return block_get_word(&line->data, word_offset);
+    return;
   }
 
-  // Step 4: L3 miss, access RAM (CACHE MISS)
-  ucm->total_misses++;
+  // Write-Through: Also update the copies in the lower levels, then RAM
+  int held_below = 0;
+  if (line == NULL && ucm->victim != NULL) {
+    CacheLine* copy = cache_probe(ucm->victim, block_address);
+    if (copy != NULL) {
+      copy->data[word_offset] = value;
+      held_below = 1;
+    }
+  }
+  for (int level = 1; level < ucm->num_levels; level++) {
+    Cache* below = ucm->levels[level];
+    CacheLine* copy = cache_probe(below, block_address);
+    access_time += below->access_time;
 
-  Block ram_block;
-  get_ram_block(ucm->ram, block_address, &ram_block);
-  access_time += 100;  // RAM access time
+    if (copy != NULL) {
+      copy->data[word_offset] = value;
+      held_below = 1;
+    }
+  }
 
-  // Load block into all cache levels (inclusive)
-  ucm_handle_miss(ucm, ucm->L3, block_address, &ram_block);
-  ucm_handle_miss(ucm, ucm->L2, block_address, &ram_block);
-  ucm_handle_miss(ucm, ucm->L1, block_address, &ram_block);
+  // A write-around store is a miss unless some level below held the block;
+  // either way it is done once RAM has it
+  if (line == NULL) {
+    ucm->source = UCM_SOURCE_RAM;
+    if (held_below) {
+      ucm->total_hits++;
+    } else {
+      ucm->total_misses++;
+    }
+  }
+
+  // Write-Through:  ALWAYS write to RAM
+  set_ram(ucm->ram, address, value);
+  access_time += ucm->ram_latency;
 
   ucm->total_time += access_time;
-  return block_get_word(&ram_block, word_offset);
 }
 
-static void ucm_write(UCM* ucm, int address, int value) {
-  int block_address = word_to_block(address);
-  int word_offset = word_to_offset(address);
+// Data totals, set aside while a fetch runs so it can be counted apart
+typedef struct UCMTotals {
+  int accesses;
+  int hits;
+  int misses;
+  uint64_t time;
+} UCMTotals;
 
-  ucm->global_time++;
-  int access_time = 0;
+static UCMTotals ucm_take_totals(UCM* ucm) {
+  UCMTotals totals = {ucm->total_accesses, ucm->total_hits,
+                      ucm->total_misses, ucm->total_time};
+  return totals;
+}
 
-  // Write-Through: Update cache if present, then propagate down
+// Move what the fetch added to the totals into the fetch counters
+static void ucm_end_fetch(UCM* ucm, const UCMTotals* before) {
+  ucm->fetch_accesses += ucm->total_accesses - before->accesses;
+  ucm->fetch_hits += ucm->total_hits - before->hits;
+  ucm->fetch_misses += ucm->total_misses - before->misses;
+  ucm->fetch_time += ucm->total_time - before->time;
 
-  // Try to update L1
-  CacheLine* line = cache_search(ucm->L1, block_address, word_offset);
-  access_time += ucm->L1->access_time;
+  ucm->total_accesses = before->accesses;
+  ucm->total_hits = before->hits;
+  ucm->total_misses = before->misses;
+  ucm->total_time = before->time;
+  ucm->levels[0] = ucm->l1d;
+}
 
-  if (line != NULL) {
-    // L1 HIT - update value
-    ucm->total_hits++;
-    block_set_word(&line->data, word_offset, value);
-    line->lru_counter = ucm->global_time;
+// Levels the last access missed, from who served it
+static int ucm_levels_missed(const UCM* ucm) {
+  if (ucm->source == UCM_SOURCE_RAM) return ucm->num_levels;
+  if (ucm->source == UCM_SOURCE_VICTIM) return 1;
+  return ucm->source;
+}
+
+// The level's MSHR that frees up first
+static UCMMshr* ucm_mshr_earliest(UCM* ucm, int level) {
+  UCMMshr* earliest = &ucm->mshrs[level][0];
+  for (int i = 1; i < ucm->mshr_count[level]; i++) {
+    if (ucm->mshrs[level][i].ready < earliest->ready) {
+      earliest = &ucm->mshrs[level][i];
+    }
+  }
+  return earliest;
+}
+
+// Miss on this block still arriving into L1 at `time`, or NULL
+static UCMMshr* ucm_mshr_pending(UCM* ucm, uint64_t block, uint64_t time) {
+  for (int i = 0; i < ucm->mshr_count[0]; i++) {
+    UCMMshr* entry = &ucm->mshrs[0][i];
+    if (entry->block == block && entry->ready > time) return entry;
+  }
+  return NULL;
+}
+
+// When the next access may start (non-blocking timing)
+static uint64_t ucm_issue_time(const UCM* ucm) {
+  return (ucm->overlap_depth > 0) ? ucm->next_issue : ucm->clock;
+}
+
+// Place an access that took `latency` cycles in non-blocking time: a miss
+// holds an MSHR on each level it missed (waiting for one if they are all
+// busy), and a hit on a block still in flight ends when the block arrives
+static void ucm_complete(UCM* ucm, uint64_t block, int fetching,
+                         uint64_t start, uint64_t latency) {
+  int missed = fetching ? 0 : ucm_levels_missed(ucm);
+  uint64_t done = start + latency;
+
+  if (!fetching && missed == 0) {
+    UCMMshr* pending = ucm_mshr_pending(ucm, block, start);
+    if (pending != NULL) {
+      ucm->mshr_merges++;
+      if (pending->ready > done) done = pending->ready;
+    }
+  } else if (missed > 0) {
+    int stalled = 0;
+    for (int level = 0; level < missed; level++) {
+      if (ucm->mshrs[level] == NULL) continue;
+      UCMMshr* entry = ucm_mshr_earliest(ucm, level);
+      if (entry->ready > start) {
+        start = entry->ready;
+        stalled = 1;
+      }
+    }
+    if (stalled) ucm->mshr_stalls++;
+    done = start + latency;
+
+    for (int level = 0; level < missed; level++) {
+      if (ucm->mshrs[level] == NULL) continue;
+      UCMMshr* entry = ucm_mshr_earliest(ucm, level);
+      entry->block = block;
+      entry->ready = done;
+    }
+
+    // Misses start in order, so the busy time grows only past miss_end
+    ucm->miss_cycles += done - start;
+    if (done > ucm->miss_end) {
+      ucm->miss_busy += done - (start > ucm->miss_end ? start : ucm->miss_end);
+      ucm->miss_end = done;
+    }
+  }
+
+  if (ucm->overlap_depth > 0) {
+    ucm->next_issue = start + 1;  // One access issued per cycle
+    if (done > ucm->overlap_end) ucm->overlap_end = done;
   } else {
-    // L1 MISS - load block first
-    Block temp_block;
-    get_ram_block(ucm->ram, block_address, &temp_block);
-    block_set_word(&temp_block, word_offset, value);
-    cache_load(ucm->L1, block_address, &temp_block, ucm->global_time);
+    ucm->clock = done;
   }
+  ucm->total_time = ucm->clock - ucm->fetch_time;
+}
 
-  // Write-Through: Also update L2
-  line = cache_search(ucm->L2, block_address, word_offset);
-  access_time += ucm->L2->access_time;
+void ucm_overlap_begin(UCM* ucm) {
+  if (ucm == NULL || !ucm->nonblocking) return;
 
-  if (line != NULL) {
-    block_set_word(&line->data, word_offset, value);
-    line->lru_counter = ucm->global_time;
+  if (ucm->overlap_depth++ == 0) {
+    ucm->next_issue = ucm->clock;
+    ucm->overlap_end = ucm->clock;
   }
+}
 
-  // Write-Through: Also update L3
-  line = cache_search(ucm->L3, block_address, word_offset);
-  access_time += ucm->L3->access_time;
+void ucm_overlap_end(UCM* ucm) {
+  if (ucm == NULL || !ucm->nonblocking || ucm->overlap_depth == 0) return;
 
-  if (line != NULL) {
-    block_set_word(&line->data, word_offset, value);
-    line->lru_counter = ucm->global_time;
+  if (--ucm->overlap_depth == 0) {
+    ucm->clock = ucm->overlap_end;
+    ucm->total_time = ucm->clock - ucm->fetch_time;
   }
+}
 
-  // Write-Through:  ALWAYS write to RAM
-  set_ram(ucm->ram, address, value);
-  access_time += 100;  // RAM access time
+// ucm_access, also giving back the L1 line the access left the block in
+// (NULL if it is not in L1)
+static int ucm_access_line(UCM* ucm, uint64_t address,
+                           UCM_Operation operation, int value,
+                           CacheLine** l1_line) {
+  // Cores of a multi-core system: the coherence protocol does the access
+  // (and their lines can change under snoops, so the batch keeps none)
+  if (ucm->smp != NULL) {
+    *l1_line = NULL;
+    return smp_access(ucm->smp, ucm->core, address, operation, value);
+  }
 
-  ucm->total_time += access_time;
+  int fetching = (operation == UCM_FETCH);
+
+  // Non-blocking: the access runs from its issue time, so late prefetches
+  // and the levels' latencies are measured from there
+  uint64_t start = 0;
+  if (ucm->nonblocking) {
+    start = ucm_issue_time(ucm);
+    ucm->total_time = start - ucm->fetch_time;
+  }
+  UCMTotals before = ucm_take_totals(ucm);
+
+  // L1I stands in for L1 for the whole fetch
+  if (fetching && ucm->l1i != NULL) ucm->levels[0] = ucm->l1i;
+
+  ucm->total_accesses++;
+
+  if (ucm->trace != NULL) {
+    trace_writer_record(ucm->trace, address, operation, value);
+  }
+  if (ucm->reuse != NULL && !fetching) {
+    reuse_record(ucm->reuse, word_to_block(&ucm->block, address));
+  }
+
+  uint64_t disk_before = ram_disk_operations(ucm->ram);
+
+  int result = 0;
+  if (operation == UCM_WRITE) {
+    ucm_write(ucm, address, value, l1_line);
+  } else {
+    result = ucm_read(ucm, address, l1_line);
+  }
+
+  // Pages the access moved to or from the swap file
+  uint64_t disk_operations = ram_disk_operations(ucm->ram) - disk_before;
+  if (disk_operations > 0) {
+    ucm->disk_accesses++;
+    ucm->total_time += disk_operations * (uint64_t)ucm->disk_latency;
+  }
+
+  // Fetch ahead only after the access, so it cannot evict the line in use
+  if (ucm->prefetch_pending) {
+    ucm->prefetch_pending = 0;
+    ucm_prefetch(ucm, ucm->prefetch_block);
+  }
+
+  if (ucm->profile != NULL) {
+    profile_record(ucm->profile, word_to_block(&ucm->block, address),
+                   operation, ucm->source, ucm->total_time - before.time);
+  }
+
+  if (ucm->nonblocking) {
+    ucm_complete(ucm, word_to_block(&ucm->block, address), fetching, start,
+                 ucm->total_time - before.time);
+  }
+
+  if (fetching) ucm_end_fetch(ucm, &before);
+
+  return result;
 }
 
-int ucm_access(UCM* ucm, int address, UCM_Operation operation, int value) {
+int ucm_access(UCM* ucm, uint64_t address, UCM_Operation operation,
+               int value) {
   if (ucm == NULL) return 0;
 
+  CacheLine* l1_line;
+  return ucm_access_line(ucm, address, operation, value, &l1_line);
+}
+
+// Plain L1 hit on a line the batch already knows, with the same effects
+// ucm_read/ucm_write have on that path
+static int ucm_batch_hit(UCM* ucm, CacheLine* line, uint64_t address,
+                         UCM_Operation operation, int value) {
+  Cache* l1 = ucm->levels[0];
+  int word_offset = word_to_offset(&ucm->block, address);
+
   ucm->total_accesses++;
+  if (ucm->trace != NULL) {
+    trace_writer_record(ucm->trace, address, operation, value);
+  }
+  if (ucm->reuse != NULL) {
+    reuse_record(ucm->reuse, word_to_block(&ucm->block, address));
+  }
 
-  if (operation == UCM_READ) {
-    return ucm_read(ucm, address);
-  } else {
-    ucm_write(ucm, address, value);
+  ucm->source = 0;
+  l1->hits++;
+  miss_classifier_record(l1->classifier, word_to_block(&ucm->block, address),
+                         1);
+  ucm->total_hits++;
+  cache_touch(l1, line);
+  ucm->total_time += l1->access_time;
+  if (ucm->profile != NULL) {
+    profile_record(ucm->profile, word_to_block(&ucm->block, address),
+                   operation, 0, l1->access_time);
+  }
+
+  if (operation == UCM_WRITE) {
+    ucm->write_accesses++;
+    line->data[word_offset] = value;
+    line->dirty = 1;
     return 0;
   }
+  return line->data[word_offset];
+}
+
+size_t ucm_access_batch(UCM* ucm, const uint64_t* addresses,
+                        const UCM_Operation* operations, const int* values,
+                        int* results, size_t count) {
+  if (ucm == NULL || addresses == NULL) return 0;
+
+  int write_back = (ucm->write_policy == UCM_WRITE_BACK);
+
+  for (size_t i = 0; i < count; i++) {
+    uint64_t address = addresses[i];
+    UCM_Operation operation = (operations != NULL) ? operations[i] : UCM_READ;
+    int value = (values != NULL) ? values[i] : 0;
+
+    uint64_t block_address = word_to_block(&ucm->block, address);
+    CacheLine** slot = &ucm->batch_lines[block_address & ucm->batch_mask];
+    CacheLine* line = *slot;
+
+    // The shortcut only knows blocking timing
+    int result;
+    if (!ucm->nonblocking && line != NULL && line->valid &&
+        line->tag == block_address && !line->prefetched &&
+        (operation == UCM_READ || (operation == UCM_WRITE && write_back))) {
+      result = ucm_batch_hit(ucm, line, address, operation, value);
+    } else {
+      result = ucm_access_line(ucm, address, operation, value, slot);
+      if (operation == UCM_FETCH) *slot = NULL;  // The line is in L1I
+    }
+
+    if (results != NULL) results[i] = result;
+  }
+
+  return count;
 }
 
 void ucm_reset_stats(UCM* ucm) {
   if (ucm == NULL) return;
 
-  ucm->global_time = 0;
   ucm->total_accesses = 0;
   ucm->total_hits = 0;
   ucm->total_misses = 0;
+  ucm->disk_accesses = 0;
+  ucm->write_accesses = 0;
+  ucm->write_misses = 0;
+  ucm->write_allocates = 0;
+  ucm->write_arounds = 0;
+  ucm->back_invalidations = 0;
   ucm->total_time = 0;
+  ucm->fetch_accesses = 0;
+  ucm->fetch_hits = 0;
+  ucm->fetch_misses = 0;
+  ucm->fetch_time = 0;
+
+  // Time restarts at 0, so nothing can still be in flight
+  ucm->clock = 0;
+  ucm->next_issue = 0;
+  ucm->overlap_end = 0;
+  ucm->miss_end = 0;
+  ucm->mshr_merges = 0;
+  ucm->mshr_stalls = 0;
+  ucm->miss_cycles = 0;
+  ucm->miss_busy = 0;
+  for (int level = 0; level < UCM_MAX_LEVELS; level++) {
+    for (int i = 0; i < ucm->mshr_count[level]; i++) {
+      ucm->mshrs[level][i].ready = 0;
+    }
+  }
+
+  for (int level = 0; level < ucm->num_levels; level++) {
+    cache_reset_stats(ucm->levels[level]);
+  }
+  cache_reset_stats(ucm->l1i);
+  cache_reset_stats(ucm->victim);
+  prefetcher_reset_stats(ucm->prefetcher);
+  if (ucm->smp != NULL) smp_reset_core_stats(ucm->smp, ucm->core);
+}
+
+static int ucm_compare_blocks(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*)a;
+  uint64_t y = *(const uint64_t*)b;
+  return (x > y) - (x < y);
+}
+
+// Distinct blocks held by all the caches together (-1 if out of memory)
+static int ucm_unique_blocks(const UCM* ucm, int* total_lines) {
+  Cache* caches[UCM_MAX_LEVELS + 2];
+  int count = ucm_upper_caches(ucm, ucm->num_levels, caches);
+
+  *total_lines = 0;
+  for (int i = 0; i < count; i++) *total_lines += caches[i]->num_lines;
+
+  uint64_t* tags = (uint64_t*)malloc((size_t)*total_lines * sizeof(uint64_t));
+  if (tags == NULL) return -1;
+
+  int valid = 0;
+  for (int i = 0; i < count; i++) {
+    for (int j = 0; j < caches[i]->num_lines; j++) {
+      if (caches[i]->lines[j].valid) tags[valid++] = caches[i]->lines[j].tag;
+    }
+  }
+  qsort(tags, (size_t)valid, sizeof(uint64_t), ucm_compare_blocks);
+
+  int unique = 0;
+  for (int i = 0; i < valid; i++) {
+    if (i == 0 || tags[i] != tags[i - 1]) unique++;
+  }
+
+  free(tags);
+  return unique;
+}
+
+static const char* ucm_inclusion_name(UCM_InclusionPolicy inclusion) {
+  switch (inclusion) {
+    case UCM_INCLUSIVE:
+      return "inclusive";
+    case UCM_EXCLUSIVE:
+      return "exclusive";
+    default:
+      return "NINE";
+  }
+}
+
+static void ucm_get_cache_stats(const Cache* cache, CacheStats* stats) {
+  stats->lines = cache->num_lines;
+  stats->associativity = cache->associativity;
+  stats->latency = cache->access_time;
+  stats->hits = cache->hits;
+  stats->misses = cache->misses;
+  stats->writebacks = cache->writebacks;
+  stats->classified =
+      (cache->classifier != NULL && !cache->classifier->failed);
+  stats->compulsory = stats->classified ? cache->classifier->compulsory : 0;
+  stats->capacity = stats->classified ? cache->classifier->capacity : 0;
+  stats->conflict = stats->classified ? cache->classifier->conflict : 0;
+}
+
+void ucm_get_stats(const UCM* ucm, UCMStats* stats) {
+  if (ucm == NULL || stats == NULL) return;
+
+  memset(stats, 0, sizeof(UCMStats));
 
-  cache_reset_stats(ucm->L1);
-  cache_reset_stats(ucm->L2);
-  cache_reset_stats(ucm->L3);
+  stats->num_levels = ucm->num_levels;
+  for (int level = 0; level < ucm->num_levels; level++) {
+    ucm_get_cache_stats(ucm->levels[level], &stats->levels[level]);
+  }
+  if (ucm->l1i != NULL) {
+    stats->has_l1i = 1;
+    ucm_get_cache_stats(ucm->l1i, &stats->l1i);
+  }
+  if (ucm->victim != NULL) {
+    stats->has_victim = 1;
+    ucm_get_cache_stats(ucm->victim, &stats->victim);
+  }
+
+  stats->total_accesses = ucm->total_accesses;
+  stats->total_hits = ucm->total_hits;
+  stats->total_misses = ucm->total_misses;
+  stats->total_time = ucm->total_time;
+  if (ucm->total_accesses > 0) {
+    stats->hit_rate = (double)ucm->total_hits / (double)ucm->total_accesses;
+    stats->amat = (double)ucm->total_time / (double)ucm->total_accesses;
+  }
+
+  stats->disk_accesses = ucm->disk_accesses;
+  stats->page_faults = ucm->ram->page_faults;
+  stats->disk_reads = ucm->ram->disk_reads;
+  stats->disk_writes = ucm->ram->disk_writes;
+
+  stats->write_accesses = ucm->write_accesses;
+  stats->write_misses = ucm->write_misses;
+  stats->write_allocates = ucm->write_allocates;
+  stats->write_arounds = ucm->write_arounds;
+  stats->back_invalidations = ucm->back_invalidations;
+  stats->unique_blocks = ucm_unique_blocks(ucm, &stats->cached_lines);
+
+  stats->fetch_accesses = ucm->fetch_accesses;
+  stats->fetch_hits = ucm->fetch_hits;
+  stats->fetch_misses = ucm->fetch_misses;
+  stats->fetch_time = ucm->fetch_time;
+  if (ucm->fetch_accesses > 0) {
+    stats->fetch_amat = (double)ucm->fetch_time / (double)ucm->fetch_accesses;
+  }
+
+  stats->mshr_merges = ucm->mshr_merges;
+  stats->mshr_stalls = ucm->mshr_stalls;
+  if (ucm->miss_busy > 0) {
+    stats->mlp = (double)ucm->miss_cycles / (double)ucm->miss_busy;
+  }
+
+  if (ucm->prefetcher != NULL) {
+    stats->has_prefetch = 1;
+    stats->prefetch_issued = ucm->prefetcher->issued;
+    stats->prefetch_useful = ucm->prefetcher->useful;
+    stats->prefetch_late = ucm->prefetcher->late;
+    stats->prefetch_polluting = ucm->prefetcher->polluting;
+  }
+
+  stats->write_policy =
+      (ucm->write_policy == UCM_WRITE_BACK) ? "write-back" : "write-through";
+  stats->allocate_policy = (ucm->allocate_policy == UCM_WRITE_ALLOCATE)
+                               ? "write-allocate"
+                               : "no-write-allocate";
+  stats->inclusion = (ucm->inclusion == UCM_INCLUSIVE)   ? "inclusive"
+                     : (ucm->inclusion == UCM_EXCLUSIVE) ? "exclusive"
+                                                         : "nine";
 }
 
 double ucm_get_hit_rate(UCM* ucm) {
@@ -214,6 +1246,35 @@ double ucm_get_hit_rate(UCM* ucm) {
   return (double)ucm->total_hits / (double)ucm->total_accesses;
 }
 
+static void ucm_print_miss_classes(const Cache* cache) {
+  if (cache->classifier == NULL) return;
+  if (cache->classifier->failed) {
+    printf("║   Miss split stopped: out of memory            ║\n");
+    return;
+  }
+
+  printf("║   Compulsory: %6d   Capacity: %6d        ║\n",
+         cache->classifier->compulsory, cache->classifier->capacity);
+  printf("║   Conflict:   %6d                           ║\n",
+         cache->classifier->conflict);
+}
+
+static void ucm_print_cache_stats(const UCM* ucm, const Cache* cache) {
+  printf("║   Hits:   %6d   Misses: %6d              ║\n", cache->hits,
+         cache->misses);
+  if (cache->hits + cache->misses > 0) {
+    double hit_rate = (double)cache->hits /
+                      (double)(cache->hits + cache->misses) * 100.0;
+    printf("║   Hit Rate: %.2f%%                              ║\n", hit_rate);
+  }
+  if (ucm->write_policy == UCM_WRITE_BACK) {
+    printf("║   Writebacks: %6d                           ║\n",
+           cache->writebacks);
+  }
+  ucm_print_miss_classes(cache);
+  printf("╠════════════════════════════════════════════════╣\n");
+}
+
 void ucm_print_stats(UCM* ucm) {
   if (ucm == NULL) return;
 
@@ -227,49 +1288,112 @@ void ucm_print_stats(UCM* ucm) {
   printf("║ Total Cache Hits:      %6d                  ║\n", ucm->total_hits);
   printf("║ Total Cache Misses:    %6d                  ║\n",
          ucm->total_misses);
+  if (ucm->ram->num_frames > 0) {
+    printf("║ Disk Accesses:         %6d                  ║\n",
+           ucm->disk_accesses);
+    printf("║   Faults: %6llu Reads: %6llu Writes: %6llu  ║\n",
+           (unsigned long long)ucm->ram->page_faults,
+           (unsigned long long)ucm->ram->disk_reads,
+           (unsigned long long)ucm->ram->disk_writes);
+  }
   printf("╠════════════════════════════════════════════════╣\n");
 
-  // L1 statistics
-  printf("║ L1 Cache Statistics:                           ║\n");
-  printf("║   Hits:   %6d   Misses:  %6d              ║\n", ucm->L1->hits,
-         ucm->L1->misses);
-  if (ucm->L1->hits + ucm->L1->misses > 0) {
-    double l1_hit_rate = (double)ucm->L1->hits /
-                         (double)(ucm->L1->hits + ucm->L1->misses) * 100.0;
-    printf("║   Hit Rate: %.2f%%                              ║\n",
-           l1_hit_rate);
+  // Per-level statistics
+  for (int level = 0; level < ucm->num_levels; level++) {
+    Cache* cache = ucm->levels[level];
+
+    if (level == 0 && ucm->l1i != NULL) {
+      printf("║ L1D Cache Statistics:                          ║\n");
+    } else {
+      printf("║ L%d Cache Statistics:                           ║\n",
+             level + 1);
+    }
+    ucm_print_cache_stats(ucm, cache);
+
+    if (level == 0 && ucm->l1i != NULL) {
+      printf("║ L1I Cache Statistics:                          ║\n");
+      ucm_print_cache_stats(ucm, ucm->l1i);
+    }
+
+    if (level == 0 && ucm->victim != NULL) {
+      Cache* victim = ucm->victim;
+      printf("║ Victim Cache (%3d lines, %3d cycles):          ║\n",
+             victim->num_lines, victim->access_time);
+      printf("║   Hits:   %6d   Misses: %6d              ║\n", victim->hits,
+             victim->misses);
+      ucm_print_miss_classes(victim);
+      printf("╠════════════════════════════════════════════════╣\n");
+    }
   }
-  printf("╠════════════════════════════════════════════════╣\n");
 
-  // L2 statistics
-  printf("║ L2 Cache Statistics:                           ║\n");
-  printf("║   Hits:   %6d   Misses: %6d              ║\n", ucm->L2->hits,
-         ucm->L2->misses);
-  if (ucm->L2->hits + ucm->L2->misses > 0) {
-    double l2_hit_rate = (double)ucm->L2->hits /
-                         (double)(ucm->L2->hits + ucm->L2->misses) * 100.0;
-    printf("║   Hit Rate: %.2f%%                              ║\n",
-           l2_hit_rate);
+  if (ucm->prefetcher != NULL) {
+    Prefetcher* prefetcher = ucm->prefetcher;
+    printf("║ Prefetch: %-9s degree %2d into L%d          ║\n",
+           prefetcher_policy_name(prefetcher->policy), prefetcher->degree,
+           ucm->prefetch_level + 1);
+    printf("║   Issued: %6d   Useful: %6d              ║\n",
+           prefetcher->issued, prefetcher->useful);
+    printf("║   Late:   %6d   Polluting: %6d           ║\n",
+           prefetcher->late, prefetcher->polluting);
+    printf("╠════════════════════════════════════════════════╣\n");
   }
-  printf("╠════════════════════════════════════════════════╣\n");
 
-  // L3 statistics
-  printf("║ L3 Cache Statistics:                           ║\n");
-  printf("║   Hits:   %6d   Misses: %6d              ║\n", ucm->L3->hits,
-         ucm->L3->misses);
-  if (ucm->L3->hits + ucm->L3->misses > 0) {
-    double l3_hit_rate = (double)ucm->L3->hits /
-                         (double)(ucm->L3->hits + ucm->L3->misses) * 100.0;
-    printf("║   Hit Rate: %.2f%%                              ║\n",
-           l3_hit_rate);
+  if (ucm->fetch_accesses > 0) {
+    double fetch_rate =
+        (double)ucm->fetch_hits / (double)ucm->fetch_accesses * 100.0;
+    printf("║ Instruction Fetches:   %6d                  ║\n",
+           ucm->fetch_accesses);
+    printf("║   Hits:   %6d   Misses: %6d              ║\n", ucm->fetch_hits,
+           ucm->fetch_misses);
+    printf("║   Hit Rate: %.2f%%                              ║\n", fetch_rate);
+    printf("║   Fetch Time (cycles): %6llu                  ║\n",
+           (unsigned long long)ucm->fetch_time);
+    printf("║   Average Time per Fetch: %.2f cycles         ║\n",
+           (double)ucm->fetch_time / (double)ucm->fetch_accesses);
+    printf("╠════════════════════════════════════════════════╣\n");
+  }
+
+  if (ucm->nonblocking) {
+    double mlp = (ucm->miss_busy > 0)
+                     ? (double)ucm->miss_cycles / (double)ucm->miss_busy
+                     : 0.0;
+    printf("║ Non-blocking Caches (%2d L1 MSHRs):             ║\n",
+           ucm->mshr_count[0]);
+    printf("║   Merged: %6d   Stalls: %6d              ║\n",
+           ucm->mshr_merges, ucm->mshr_stalls);
+    printf("║   Achieved MLP: %.2f                           ║\n", mlp);
+    printf("╠════════════════════════════════════════════════╣\n");
   }
-  printf("╠════════════════════════════════════════════════╣\n");
 
   // Global statistics
   double overall_hit_rate = ucm_get_hit_rate(ucm) * 100.0;
   printf("║ Overall Hit Rate:  %.2f%%                        ║\n",
          overall_hit_rate);
-  printf("║ Total Time (cycles): %6d                    ║\n", ucm->total_time);
+  printf("║ Writes: %6d   Write Misses: %6d         ║\n",
+         ucm->write_accesses, ucm->write_misses);
+  if (ucm->allocate_policy == UCM_WRITE_ALLOCATE) {
+    printf("║   Write-Allocate Fills: %6d                 ║\n",
+           ucm->write_allocates);
+  } else {
+    printf("║   No-Write-Allocate Bypasses: %6d           ║\n",
+           ucm->write_arounds);
+  }
+  printf("║ Write Policy: %-13s                    ║\n",
+         ucm->write_policy == UCM_WRITE_BACK ? "write-back" : "write-through");
+  printf("║ Inclusion: %-10s                          ║\n",
+         ucm_inclusion_name(ucm->inclusion));
+  int total_lines;
+  int unique = ucm_unique_blocks(ucm, &total_lines);
+  if (unique >= 0) {
+    printf("║   Unique Blocks Cached: %6d of %6d lines ║\n", unique,
+           total_lines);
+  }
+  if (ucm->inclusion == UCM_INCLUSIVE) {
+    printf("║   Back-Invalidations: %6d                   ║\n",
+           ucm->back_invalidations);
+  }
+  printf("║ Total Time (cycles): %6llu                    ║\n",
+         (unsigned long long)ucm->total_time);
 
   // Average time per access
   if (ucm->total_accesses > 0) {